@@ -2,14 +2,20 @@
 #include <debug.h>
 #include "devices/intq.h"
 #include "devices/serial.h"
+#include "threads/synch.h"
 
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
 
+/* Upped when a key arrives while threads sleep in input_wait(). */
+static struct semaphore avail;
+static int avail_waiters;       /* Threads in input_wait(). */
+
 /* Initializes the input buffer. */
 void
 input_init (void) {
 	intq_init (&buffer);
+	sema_init (&avail, 0);
 }
 
 /* Adds a key to the input buffer.
@@ -20,6 +26,8 @@ input_putc (uint8_t key) {
 	ASSERT (!intq_full (&buffer));
 
 	intq_putc (&buffer, key);
+	if (avail_waiters > 0)
+		sema_up (&avail);
 	serial_notify ();
 }
 
@@ -46,3 +54,27 @@ input_full (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	return intq_full (&buffer);
 }
+
+/* Returns true if the input buffer is empty,
+   false otherwise.
+   Interrupts must be off. */
+bool
+input_empty (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	return intq_empty (&buffer);
+}
+
+/* Sleeps until a key may have arrived, by calling SLEEP on a
+   semaphore that input_putc() ups.  SLEEP may also return early,
+   e.g. to let the caller give up, and wakeups may be spurious, so
+   the caller must check input_empty() again.  Unlike
+   input_getc(), any number of threads may wait at once.
+   Interrupts must be off. */
+void
+input_wait (void (*sleep) (struct semaphore *)) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	avail_waiters++;
+	sleep (&avail);
+	avail_waiters--;
+}
@@ -23,7 +23,64 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Hierarchical timer wheel.
+
+   Pending timeouts hang off WHEEL_LEVELS levels of WHEEL_SIZE
+   slots each.  Level 0 has one slot per tick; each slot of level
+   L covers WHEEL_SIZE^L ticks.  A timeout goes into the lowest
+   level whose range covers its distance from wheel_clk, so arming
+   and cancelling are O(1).  Whenever the level-0 index wraps to
+   zero, the current slot of the next level is "cascaded": its
+   timeouts are re-armed and land in finer slots.  Deadlines past
+   the top level's range are parked in its farthest slot and
+   cascaded again until they come within range. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_RANGE ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* Next tick the wheel will process.  Every timeout due before
+   wheel_clk has already fired. */
+static int64_t wheel_clk;
+
+/* Tickless idle.
+   Normally counter 0 of the 8254 runs in rate-generator mode and
+   interrupts every tick.  When the CPU goes idle with nothing due
+   for a few ticks, timer_idle_enter() reprograms it in one-shot
+   mode to fire on the tick boundary of the next wheel event, and
+   the interrupt (or timer_idle_exit(), if something else woke the
+   CPU first) catches `ticks' up by however many boundaries passed.
+   A 16-bit count limits one sleep to about 55 ms. */
+bool timer_tickless;
+
+#define PIT_HZ 1193180          /* 8254 input frequency. */
+#define PIT_CH0 0x40            /* Counter 0 data port. */
+#define PIT_CTRL 0x43           /* Control word port. */
+#define PIT_RATE 0x34           /* Counter 0, LSB then MSB, mode 2, binary. */
+#define PIT_ONESHOT 0x30        /* Counter 0, LSB then MSB, mode 0, binary. */
+#define PIT_READBACK 0xc2       /* Latch status and count of counter 0. */
+#define PIT_STATUS_OUT 0x80     /* Status: OUT pin high (mode 0 done). */
+
+static unsigned pit_count;      /* PIT cycles per tick. */
+static bool oneshot;            /* Counter 0 in one-shot mode? */
+static unsigned oneshot_count;  /* Count programmed for the one-shot. */
+static unsigned oneshot_first;  /* Cycles from programming to 1st boundary. */
+static int64_t oneshot_ticks;   /* Boundaries until the one-shot fires. */
+static int64_t skipped_ticks;   /* Ticks accounted without their interrupt. */
+
 static intr_handler_func timer_interrupt;
+static void pit_program (uint8_t mode, unsigned count);
+static unsigned pit_read_count (void);
+static bool pit_irq_pending (void);
+static int64_t oneshot_settle (bool in_interrupt);
+static void timer_advance (int64_t n);
+static int64_t wheel_next_event (int64_t limit);
+static void wheel_insert (struct timeout *);
+static void wheel_cascade (int level, int idx);
+static void wheel_run (int64_t now);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -35,13 +92,15 @@ void
 timer_init (void) {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	pit_count = (PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_program (PIT_RATE, pit_count);
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+
+	for (int level = 0; level < WHEEL_LEVELS; level++)
+		for (int idx = 0; idx < WHEEL_SIZE; idx++)
+			list_init (&wheel[level][idx]);
+	wheel_clk = ticks + 1;
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -119,18 +178,276 @@ timer_nsleep (int64_t ns) {
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (timer_tickless)
+		printf ("Timer: %"PRId64" ticks skipped while idle\n", skipped_ticks);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  If tickless mode is on and no timeout is due within the
+   next few ticks, switches the PIT to one-shot mode so that the
+   next interrupt arrives on the tick boundary of the next wheel
+   event instead of every tick.  The idle thread has no time slice
+   to enforce, so wheel events are the only deadlines. */
+void
+timer_idle_enter (void) {
+	unsigned remaining;
+	int64_t n;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || oneshot)
+		return;
+
+	/* Cycles left until the next tick boundary.  Checking the PIC
+	   afterward tells us whether a boundary slipped by unhandled;
+	   staying clear of the boundary keeps one from slipping by
+	   before the one-shot is programmed. */
+	remaining = pit_read_count ();
+	if (pit_irq_pending () || remaining < pit_count / 16)
+		return;
+
+	n = wheel_next_event (ticks + 65535 / pit_count) - ticks;
+	if (n < 2)
+		return;
+
+	oneshot = true;
+	oneshot_first = remaining;
+	oneshot_count = remaining + (n - 1) * pit_count;
+	oneshot_ticks = n;
+	pit_program (PIT_ONESHOT, oneshot_count);
+}
+
+/* Called by the idle thread, with interrupts off, after it wakes
+   up.  If an interrupt other than the timer woke the CPU, accounts
+   for the tick boundaries that have passed so that timer_ticks()
+   is current before any other thread runs. */
+void
+timer_idle_exit (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (oneshot)
+		timer_advance (oneshot_settle (false));
+}
+
+/* Ends or shortens the one-shot in progress and returns the
+   number of tick boundaries that have passed since it was
+   programmed.  If the one-shot has fired, resumes periodic mode.
+   Otherwise reprograms the PIT to fire at the next boundary, which
+   will then resume periodic mode; this keeps the tick phase
+   instead of restarting it mid-tick.  Outside of the interrupt
+   handler a fired one-shot is left alone, since its interrupt is
+   still pending and will account for it. */
+static int64_t
+oneshot_settle (bool in_interrupt) {
+	unsigned count, elapsed, rem;
+	uint8_t status;
+	int64_t n;
+
+	outb (PIT_CTRL, PIT_READBACK);
+	status = inb (PIT_CH0);
+	count = inb (PIT_CH0);
+	count |= inb (PIT_CH0) << 8;
+
+	if (status & PIT_STATUS_OUT) {
+		if (!in_interrupt)
+			return 0;
+		oneshot = false;
+		pit_program (PIT_RATE, pit_count);
+		return oneshot_ticks;
+	}
+
+	elapsed = count <= oneshot_count ? oneshot_count - count : 0;
+	if (elapsed < oneshot_first) {
+		n = 0;
+		rem = oneshot_first - elapsed;
+	} else {
+		elapsed -= oneshot_first;
+		n = 1 + elapsed / pit_count;
+		rem = pit_count - elapsed % pit_count;
+	}
+	oneshot_first = oneshot_count = rem;
+	oneshot_ticks = 1;
+	pit_program (PIT_ONESHOT, rem);
+	return n;
+}
+
+/* Accounts for N tick boundaries: advances `ticks', charges each
+   tick to the running thread and fires due timeouts. */
+static void
+timer_advance (int64_t n) {
+	if (n > 1)
+		skipped_ticks += n - 1;
+	while (n-- > 0) {
+		ticks++;
+		thread_tick ();
+		wheel_run (ticks);
+	}
+}
+
+/* Loads COUNT into PIT counter 0 in MODE. */
+static void
+pit_program (uint8_t mode, unsigned count) {
+	ASSERT (count > 0 && count <= 0xffff);
+	outb (PIT_CTRL, mode);
+	outb (PIT_CH0, count & 0xff);
+	outb (PIT_CH0, count >> 8);
+}
+
+/* Returns the current value of PIT counter 0. */
+static unsigned
+pit_read_count (void) {
+	unsigned count;
+
+	outb (PIT_CTRL, 0x00);      /* Latch counter 0. */
+	count = inb (PIT_CH0);
+	count |= inb (PIT_CH0) << 8;
+	return count;
+}
+
+/* Returns true if the PIT has raised IRQ 0 but it has not been
+   delivered yet, because interrupts are off. */
+static bool
+pit_irq_pending (void) {
+	outb (0x20, 0x0a);          /* OCW3: read IRR of the master PIC. */
+	return (inb (0x20) & 1) != 0;
 }
 
-/* Timer interrupt handler. */
+/* Initializes TO to call FUNC with AUX when it fires.  TO is not
+   armed. */
+void
+timeout_init (struct timeout *to, timeout_func *func, void *aux) {
+	ASSERT (to != NULL);
+	ASSERT (func != NULL);
+
+	to->deadline = 0;
+	to->func = func;
+	to->aux = aux;
+	to->pending = false;
+}
+
+/* Arms TO to fire at tick DEADLINE, replacing any earlier
+   deadline.  A DEADLINE that has already passed fires on the next
+   tick.  May be called from interrupt context. */
+void
+timeout_arm (struct timeout *to, int64_t deadline) {
+	enum intr_level old_level = intr_disable ();
+
+	if (to->pending)
+		list_remove (&to->elem);
+	to->deadline = deadline;
+	to->pending = true;
+	wheel_insert (to);
+	intr_set_level (old_level);
+}
+
+/* Disarms TO.  Returns true if it was pending, false if it had
+   already fired or was never armed. */
+bool
+timeout_cancel (struct timeout *to) {
+	enum intr_level old_level = intr_disable ();
+	bool was_pending = to->pending;
+
+	if (was_pending) {
+		list_remove (&to->elem);
+		to->pending = false;
+	}
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Returns true if TO is armed and has not fired yet. */
+bool
+timeout_pending (const struct timeout *to) {
+	return to->pending;
+}
+
+/* Puts TO into the wheel slot for its deadline, relative to
+   wheel_clk.  Interrupts must be off. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
+wheel_insert (struct timeout *to) {
+	int64_t expires = to->deadline;
+	int64_t delta;
+	int level;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (expires < wheel_clk)
+		expires = wheel_clk;
+	delta = expires - wheel_clk;
+	if (delta >= WHEEL_RANGE) {
+		expires = wheel_clk + WHEEL_RANGE - 1;
+		delta = WHEEL_RANGE - 1;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+			break;
+	list_push_back (&wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK],
+			&to->elem);
+}
+
+/* Re-arms every timeout in slot IDX of LEVEL so that it moves
+   down to a finer level. */
+static void
+wheel_cascade (int level, int idx) {
+	struct list *slot = &wheel[level][idx];
+
+	while (!list_empty (slot))
+		wheel_insert (list_entry (list_pop_front (slot), struct timeout, elem));
+}
+
+/* Returns the first tick before LIMIT at which the wheel has work
+   to do: a non-empty level-0 slot or a cascade.  Returns LIMIT if
+   there is none. */
+static int64_t
+wheel_next_event (int64_t limit) {
+	int64_t t;
+
+	for (t = wheel_clk; t < limit; t++)
+		if ((t & WHEEL_MASK) == 0 || !list_empty (&wheel[0][t & WHEEL_MASK]))
+			break;
+	return t;
+}
 
-	thread_tick ();
-	if(global_tick <= ticks){
-		wakeup();
+/* Fires every timeout due at or before NOW.  Runs in the timer
+   interrupt, or in the idle thread with interrupts off. */
+static void
+wheel_run (int64_t now) {
+	struct list expired;
+
+	list_init (&expired);
+	while (wheel_clk <= now) {
+		int idx = wheel_clk & WHEEL_MASK;
+		struct list *slot = &wheel[0][idx];
+
+		if (idx == 0)
+			for (int level = 1; level < WHEEL_LEVELS; level++) {
+				int lidx = (wheel_clk >> (WHEEL_BITS * level)) & WHEEL_MASK;
+				wheel_cascade (level, lidx);
+				if (lidx != 0)
+					break;
+			}
+
+		/* Advance the clock before running callbacks, so a callback
+		   that re-arms for an expired deadline lands in the next
+		   tick's slot rather than in the one being drained. */
+		if (!list_empty (slot))
+			list_splice (list_end (&expired), list_begin (slot), list_end (slot));
+		wheel_clk++;
+
+		while (!list_empty (&expired)) {
+			struct timeout *to = list_entry (list_pop_front (&expired),
+					struct timeout, elem);
+			to->pending = false;
+			to->func (to, to->aux);
+		}
 	}
-	
+}
+
+/* Timer interrupt handler. */
+static void
+timer_interrupt (struct intr_frame *args UNUSED) {
+	timer_advance (oneshot ? oneshot_settle (true) : 1);
 }
 
 
@@ -24,7 +24,7 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+	disk_sector_t sector = bitmap_scan_and_flip_next (free_map, cnt, false);
 	if (sector != BITMAP_ERROR
 			&& free_map_file != NULL
 			&& !bitmap_write (free_map, free_map_file)) {
@@ -4,9 +4,13 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+struct semaphore;
+
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
 bool input_full (void);
+bool input_empty (void);
+void input_wait (void (*sleep) (struct semaphore *));
 
 #endif /* devices/input.h */
@@ -1,7 +1,9 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -20,4 +22,32 @@ void timer_nsleep (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* If true, the idle thread stops the periodic tick while nothing
+   is due.  Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
+/* Kernel timeout.
+   Calls FUNC(TO, AUX) from the timer interrupt once timer_ticks()
+   reaches DEADLINE.  FUNC runs with interrupts off, in the timer
+   interrupt or the idle thread, so it must not sleep; it may
+   re-arm TO. */
+struct timeout;
+typedef void timeout_func (struct timeout *to, void *aux);
+
+struct timeout {
+	int64_t deadline;           /* Tick at which to fire. */
+	timeout_func *func;         /* Callback. */
+	void *aux;                  /* Callback argument. */
+	bool pending;               /* Armed and not yet fired? */
+	struct list_elem elem;      /* Timer wheel slot element. */
+};
+
+void timeout_init (struct timeout *, timeout_func *, void *aux);
+void timeout_arm (struct timeout *, int64_t deadline);
+bool timeout_cancel (struct timeout *);
+bool timeout_pending (const struct timeout *);
+
 #endif /* devices/timer.h */
@@ -119,6 +119,57 @@ static __inline uint64_t rcr2(void) {
 	return val;
 }
 
+__attribute__((always_inline))
+static __inline uint64_t rcr0(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr0,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr0(uint64_t val) {
+	__asm __volatile("movq %0, %%cr0" : : "r" (val));
+}
+
+__attribute__((always_inline))
+static __inline uint64_t rcr4(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr4,%0" : "=r" (val));
+	return val;
+}
+
+__attribute__((always_inline))
+static __inline void lcr4(uint64_t val) {
+	__asm __volatile("movq %0, %%cr4" : : "r" (val));
+}
+
+/* Clears CR0.TS so the next FPU/SSE instruction does not trap. */
+__attribute__((always_inline))
+static __inline void clts(void) {
+	__asm __volatile("clts");
+}
+
+/* Saves the x87/SSE state into the 512-byte, 16-byte aligned
+   area at BUF.  See [IA32-v2a] "FXSAVE". */
+__attribute__((always_inline))
+static __inline void fxsave(void *buf) {
+	__asm __volatile("fxsave64 (%0)" : : "r" (buf) : "memory");
+}
+
+/* Restores the x87/SSE state saved by fxsave() from BUF. */
+__attribute__((always_inline))
+static __inline void fxrstor(const void *buf) {
+	__asm __volatile("fxrstor64 (%0)" : : "r" (buf) : "memory");
+}
+
+/* Returns the time-stamp counter.  See [IA32-v2b] "RDTSC". */
+__attribute__((always_inline))
+static __inline uint64_t rdtsc(void) {
+	uint32_t edx, eax;
+	__asm __volatile("rdtsc" : "=d" (edx), "=a" (eax));
+	return ((uint64_t) edx << 32) | eax;
+}
+
 __attribute__((always_inline))
 static __inline void write_msr(uint32_t ecx, uint64_t val) {
 	uint32_t edx, eax;
@@ -0,0 +1,63 @@
+#ifndef __LIB_KERNEL_PHEAP_H
+#define __LIB_KERNEL_PHEAP_H
+
+/* Pairing heap.
+ *
+ * A priority queue with O(1) insertion and O(log n) amortized
+ * removal of the top element or of an arbitrary element.  Like
+ * lists and hash tables, heaps do not allocate memory: each
+ * structure that can be in a heap embeds a struct pheap_elem, and
+ * pheap_entry() converts an element back to its structure.
+ *
+ * The ordering is given by a "less" function passed to each
+ * operation that needs it, in the manner of list_insert_ordered().
+ * pheap_top() returns an element E such that LESS(X, E) is false
+ * for every other element X; that is, the heap pops its "smallest"
+ * element first.  To change an element's key, pheap_remove() it,
+ * update the key and pheap_push() it again.
+ *
+ * The heap is not stable.  Callers that need FIFO order among
+ * equal keys should break ties with a sequence number. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct pheap_elem {
+	struct pheap_elem *child;   /* Leftmost child. */
+	struct pheap_elem *next;    /* Right sibling. */
+	struct pheap_elem *prev;    /* Left sibling, or parent if leftmost. */
+};
+
+/* Heap. */
+struct pheap {
+	struct pheap_elem *root;    /* Top element, or NULL if empty. */
+	size_t size;                /* Number of elements. */
+};
+
+/* Converts pointer to heap element PHEAP_ELEM into a pointer to
+ * the structure that PHEAP_ELEM is embedded inside. */
+#define pheap_entry(PHEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) (PHEAP_ELEM)             \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two heap elements A and B, given
+ * auxiliary data AUX.  Returns true if A should come out of the
+ * heap before B. */
+typedef bool pheap_less_func (const struct pheap_elem *a,
+                              const struct pheap_elem *b,
+                              void *aux);
+
+void pheap_init (struct pheap *);
+bool pheap_empty (const struct pheap *);
+size_t pheap_size (const struct pheap *);
+struct pheap_elem *pheap_top (const struct pheap *);
+
+void pheap_push (struct pheap *, struct pheap_elem *,
+                 pheap_less_func *, void *aux);
+struct pheap_elem *pheap_pop (struct pheap *, pheap_less_func *, void *aux);
+void pheap_remove (struct pheap *, struct pheap_elem *,
+                   pheap_less_func *, void *aux);
+
+#endif /* lib/kernel/pheap.h */
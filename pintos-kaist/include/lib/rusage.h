@@ -0,0 +1,15 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* CPU usage of a thread, as reported by the getrusage system
+   call.  Times are in time-stamp counter cycles. */
+struct rusage {
+	uint64_t user_cycles;       /* Time spent in user mode. */
+	uint64_t kernel_cycles;     /* Time spent in the kernel. */
+	uint64_t vol_switches;      /* Switches away because we blocked. */
+	uint64_t invol_switches;    /* Switches away while still runnable. */
+};
+
+#endif /* lib/rusage.h */
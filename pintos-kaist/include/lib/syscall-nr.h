@@ -36,6 +36,14 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra. */
+	SYS_GETRUSAGE,              /* Report CPU time used. */
+	SYS_SCHED_SETDEADLINE,      /* Join or leave the deadline class. */
+	SYS_FUTEX_WAIT,             /* Sleep if a futex has a value. */
+	SYS_FUTEX_WAKE,             /* Wake futex sleepers. */
+	SYS_THREAD_CREATE,          /* Start a thread in this process. */
+	SYS_THREAD_EXIT,            /* Terminate the current thread. */
 };
 
 #endif /* lib/syscall-nr.h */
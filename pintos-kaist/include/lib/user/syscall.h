@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -37,6 +39,12 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+int getrusage (struct rusage *);
+bool sched_setdeadline (int64_t runtime, int64_t period, int64_t deadline);
+int futex_wait (int *uaddr, int val);
+int futex_wake (int *uaddr, int cnt);
+int thread_create (void (*entry) (void *), void *arg, void *stack);
+void thread_exit (int *clear) NO_RETURN;
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
@@ -0,0 +1,38 @@
+#ifndef __LIB_USER_UTHREAD_H
+#define __LIB_USER_UTHREAD_H
+
+#include <stddef.h>
+
+/* A thread in this process.  RUNNING is set while the thread is
+   alive and cleared by the kernel when it exits. */
+struct uthread {
+	int tid;
+	int running;
+	void (*func) (void *);
+	void *aux;
+};
+
+/* Mutex.  STATE is 0 if unlocked, 1 if locked, 2 if locked and
+   another thread may be sleeping on it. */
+struct umutex {
+	int state;
+};
+
+/* Condition variable.  SEQ changes on every signal. */
+struct ucond {
+	int seq;
+};
+
+int uthread_create (struct uthread *, void (*func) (void *), void *aux);
+void uthread_join (struct uthread *);
+
+void umutex_init (struct umutex *);
+void umutex_lock (struct umutex *);
+void umutex_unlock (struct umutex *);
+
+void ucond_init (struct ucond *);
+void ucond_wait (struct ucond *, struct umutex *);
+void ucond_signal (struct ucond *);
+void ucond_broadcast (struct ucond *);
+
+#endif /* lib/user/uthread.h */
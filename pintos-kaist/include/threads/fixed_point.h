@@ -0,0 +1,75 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* 17.14 fixed-point arithmetic for the 4.4BSD scheduler.
+ *
+ * A fixed_t holds a real number X as X * FP_F in a plain int:
+ * 1 sign bit, 17 integer bits and 14 fraction bits.  Products
+ * and quotients of two fixed_t values go through int64_t so
+ * that the intermediate result does not overflow. */
+typedef int fixed_t;
+
+#define FP_Q 14
+#define FP_F (1 << FP_Q)
+
+/* Converts integer N to fixed point. */
+static inline fixed_t
+int_to_fp (int n) {
+	return n * FP_F;
+}
+
+/* Converts X to integer, rounding toward zero. */
+static inline int
+fp_to_int (fixed_t x) {
+	return x / FP_F;
+}
+
+/* Converts X to integer, rounding to nearest. */
+static inline int
+fp_to_int_round (fixed_t x) {
+	return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+static inline fixed_t
+fp_add (fixed_t x, fixed_t y) {
+	return x + y;
+}
+
+static inline fixed_t
+fp_sub (fixed_t x, fixed_t y) {
+	return x - y;
+}
+
+static inline fixed_t
+fp_add_int (fixed_t x, int n) {
+	return x + n * FP_F;
+}
+
+static inline fixed_t
+fp_sub_int (fixed_t x, int n) {
+	return x - n * FP_F;
+}
+
+static inline fixed_t
+fp_mul (fixed_t x, fixed_t y) {
+	return (fixed_t) (((int64_t) x) * y / FP_F);
+}
+
+static inline fixed_t
+fp_mul_int (fixed_t x, int n) {
+	return x * n;
+}
+
+static inline fixed_t
+fp_div (fixed_t x, fixed_t y) {
+	return (fixed_t) (((int64_t) x) * FP_F / y);
+}
+
+static inline fixed_t
+fp_div_int (fixed_t x, int n) {
+	return x / n;
+}
+
+#endif /* threads/fixed_point.h */
@@ -0,0 +1,31 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Object cache for one type of fixed-size kernel object.
+   Objects smaller than half a page are carved out of one-page
+   slabs; page-sized objects (thread pages) are handed out whole.
+   Freed objects go on a LIFO free list and are reused without
+   being cleared, so callers must initialize what they use. */
+struct slab_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t obj_size;            /* Size of each object in bytes. */
+	size_t objs_per_slab;       /* Objects per slab, 0 for page objects. */
+	size_t reserve;             /* Free objects kept before returning memory. */
+	struct spinlock lock;       /* Protects the members below. */
+	struct list free_list;      /* Free objects, most recently freed first. */
+	size_t free_cnt;            /* Length of free_list. */
+	unsigned long long hits;    /* Allocations served from free_list. */
+	unsigned long long misses;  /* Allocations that needed a new page. */
+};
+
+void slab_cache_init (struct slab_cache *, const char *name,
+		size_t obj_size, size_t reserve);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
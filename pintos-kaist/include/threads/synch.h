@@ -2,13 +2,14 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <pheap.h>
 #include <stdbool.h>
 #include <debug.h> // UNUSED용 추가
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct pheap waiters;       /* Waiting threads, highest priority on top. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -21,25 +22,77 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	int donated;                /* Highest waiter priority, PRI_MIN - 1 if none. */
+	struct pheap_elem held_elem;/* Holder's held_locks element. */
+
+	/* Adaptive locks only. */
+	const char *name;           /* Name for statistics, NULL if not adaptive. */
+	unsigned long long acquires;/* Acquired without waiting. */
+	unsigned long long spins;   /* Acquired after spinning. */
+	unsigned long long sleeps;  /* Acquired after blocking. */
 };
 
 void lock_init (struct lock *);
+void lock_init_adaptive (struct lock *, const char *name);
+void lock_print_stats (void);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+/* Spinlock.
+   Busy-waits instead of sleeping and keeps interrupts off while
+   held, so it may be taken from interrupt context and protects
+   data shared between CPUs.  Hold it only for a few instructions. */
+struct spinlock {
+	volatile int locked;        /* Nonzero while held. */
+	struct thread *holder;      /* Thread holding lock (for debugging). */
+	int old_level;              /* Interrupt level before spin_lock(). */
+};
+
+void spin_init (struct spinlock *);
+void spin_lock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+bool spin_held_by_current_thread (const struct spinlock *);
+
+/* Reader-writer lock.
+   Any number of readers or a single writer may hold it.  Writers
+   are preferred: once a writer is waiting, new readers queue
+   behind it.  Waiters donate their priority to the holders,
+   including every current reader. */
+struct rwlock {
+	int readers;                /* Number of readers holding the lock. */
+	struct thread *writer;      /* Writer holding the lock, or NULL. */
+	struct list holds;          /* rw_holds of current readers. */
+	struct list read_waiters;   /* Blocked readers. */
+	struct list write_waiters;  /* Blocked writers. */
+};
+
+/* Maximum number of rwlocks one thread may hold at once. */
+#define RWLOCK_HOLD_MAX 4
+
+/* One rwlock held by a thread, kept in the thread. */
+struct rw_hold {
+	struct rwlock *rw;          /* Held rwlock, NULL if slot unused. */
+	struct thread *t;           /* Holding thread. */
+	struct list_elem elem;      /* rwlock's holds list element. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 /* Condition variable. */
 struct condition
 {
-	struct list waiters; /* List of waiting threads. */
+	struct pheap waiters; /* Waiting threads, highest priority on top. */
 };
 
 // ------------------[Project1 - Thread]------------------
 void donate_priority(void);
-void remove_with_lock(struct lock *);
 void refresh_priority(void);
-bool cmp_sema_priority(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
-bool cmp_d_elem_priority(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
+void waiter_reposition (struct thread *);
 
 void cond_init(struct condition *);
 void cond_wait (struct condition *, struct lock *);
@@ -4,7 +4,10 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include "devices/timer.h"
+#include "threads/fixed_point.h"
 #include "threads/interrupt.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #ifdef VM
 #include "vm/vm.h"
@@ -29,6 +32,21 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Number of CPUs the scheduler keeps per-CPU state for.
+   Only the BSP is brought up: the loader has no code to start
+   application processors, so this must stay 1 for now.  Work
+   stealing between run queues, adaptive-lock spinning and
+   thread_running_elsewhere() are compiled only when NCPU > 1 and
+   are not exercised by any test.  The per-CPU run queues, malloc
+   magazines, trace buffers and work queues are used with NCPU == 1
+   as single instances. */
+#define NCPU 1
+
+/* Thread niceness for the 4.4BSD scheduler. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 
 #define FDT_COUNT 64
 /* A kernel thread or user process.
@@ -94,19 +112,56 @@ struct thread {
 	enum thread_status status;          /* Thread state. */
 	char name[16];                      /* Name (for debugging purposes). */
 	int priority;                       /* Priority. */
-	int64_t getuptick;
+	int ready_pri;                      /* ready_queue index while READY. */
+	struct cpu *cpu;                    /* CPU running or queueing us. */
+	void *fpu_area;                     /* FXSAVE buffer, NULL until FPU used. */
+	struct timeout sleep_timeout;       /* Wakes us from thread_sleep(). */
+	uint64_t trace_wake_tsc;            /* When made ready, for trace.c. */
+	uint64_t trace_lock_tsc;            /* When a lock wait began, for trace.c. */
+	uint64_t user_cycles;               /* TSC cycles spent in user mode. */
+	uint64_t kernel_cycles;             /* TSC cycles spent in the kernel. */
+	uint64_t acct_tsc;                  /* TSC when last charged. */
+	bool acct_user;                     /* Charging user_cycles? */
+	int preempt_count;                  /* Nesting of thread_preempt_disable(). */
+	bool need_resched;                  /* Yield deferred by preempt_count. */
+	uint64_t vol_switches;              /* Switched away while blocked. */
+	uint64_t invol_switches;            /* Switched away while ready. */
+
+	/* Deadline scheduling class, times in timer ticks. */
+	int64_t dl_runtime;                 /* Budget per period, 0 if not deadline. */
+	int64_t dl_deadline;                /* Relative deadline. */
+	int64_t dl_period;                  /* Period. */
+	int64_t dl_bw;                      /* runtime/period, fixed point. */
+	int64_t dl_abs_deadline;            /* Current absolute deadline. */
+	int64_t dl_next_period;             /* Start of the next period. */
+	int64_t dl_budget;                  /* Budget left in this period. */
+	bool dl_throttled;                  /* Out of budget until dl_timer fires. */
+	struct timeout dl_timer;            /* Replenishes the budget. */
+	struct pheap_elem dl_elem;          /* cpu->dl_queue element. */
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
 	/* Donation variables */
-	struct list donations;				/* list of Donations (for multiple Donation).*/
-	struct list_elem d_elem;			/* donation List element. */
+	struct pheap held_locks;            /* Held locks, highest donation on top. */
 	struct lock *wait_on_lock; 			/* lock that it waits for. */
+	struct rwlock *wait_on_rwlock;      /* rwlock that it waits for. */
 	int origin_priority;
+	struct rw_hold rw_holds[RWLOCK_HOLD_MAX]; /* Held rwlocks. */
 
-	/* file */
-	struct file *fdt[64];
-	int next_fd;
+	/* Owned by synch.c. */
+	struct pheap_elem wait_elem;        /* Semaphore waiters element. */
+	struct semaphore *wait_sema;        /* Semaphore we are blocked on. */
+	unsigned long long wait_seq;        /* Tie-break among equal priorities. */
+	struct pheap_elem cond_elem;        /* Condition waiters element. */
+	struct condition *wait_cond;        /* Condition we are waiting on. */
+	struct semaphore *cond_sema;        /* Upped by cond_signal(). */
+	unsigned long long cond_seq;        /* Tie-break among equal priorities. */
 
+	/* mlfqs */
+	int nice;                           /* Niceness. */
+	fixed_t recent_cpu;                 /* Recent CPU usage, 17.14. */
+	struct list_elem all_elem;          /* all_list element. */
+	struct list_elem mlfqs_elem;        /* mlfqs_dirty_list element. */
+	bool mlfqs_dirty;                   /* On mlfqs_dirty_list? */
 
 	/* fork */
 	struct semaphore fork_sema;
@@ -116,16 +171,13 @@ struct thread {
 	struct list child;
 	struct thread *parent;
 
-	/* rox */
-	struct file *running_file;
-
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
-	uint64_t *pml4;                     /* Page map level 4 */
-#endif
-#ifdef VM
-	/* Table for whole virtual memory owned by thread. */
-	struct supplemental_page_table spt;
+	struct process *proc;               /* Shared by the process's threads. */
+	uint64_t *pml4;                     /* Page map level 4, proc->pml4. */
+	int stack_slot;                     /* Kernel-allocated user stack, or -1. */
+	struct list_elem sleep_elem;        /* proc->sleepers element. */
+	struct semaphore *sleep_sema;       /* Semaphore of process_sleep(). */
 #endif
 
 	/* Owned by thread.c. */
@@ -143,6 +195,9 @@ struct child_status {
 	struct semaphore wait_sema;
 };
 
+/* child_status 캐시. thread_create()가 할당하고 process_wait()가 반환한다. */
+extern struct slab_cache child_status_cache;
+
 
 
 
@@ -153,7 +208,6 @@ extern bool thread_mlfqs;
 
 void thread_init (void);
 void thread_start (void);
-int64_t global_tick;
 void thread_tick (void);
 void thread_print_stats (void);
 
@@ -165,15 +219,25 @@ void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
+#if NCPU > 1
+bool thread_running_elsewhere (const struct thread *);
+#endif
+int thread_cpu_id (void);
+
+struct rusage;
+void thread_acct_mode (bool user);
+void thread_get_rusage (struct rusage *);
 const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt_check (struct thread *);
+void thread_preempt_disable (void);
+void thread_preempt_enable (void);
 // 정의한 함수 선언 - ch
-bool getuptick_less(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
 bool priority_more(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
 void thread_sleep(int64_t getuptick);
-void wakeup(void);
+void thread_reposition_ready (struct thread *t);
 // end
 int thread_get_priority(void);
 void thread_set_priority (int);
@@ -183,6 +247,12 @@ void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+bool thread_set_deadline (int64_t runtime, int64_t period, int64_t deadline);
+
+bool thread_fpu_acquire (void);
+bool thread_fpu_fork (struct thread *parent);
+void thread_fpu_release (void);
+
 void do_iret (struct intr_frame *tf);
 
 #endif /* threads/thread.h */
@@ -0,0 +1,44 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Scheduler trace event types. */
+enum trace_type {
+	TRACE_SWITCH,               /* TID switched in, ARG switched out. */
+	TRACE_PREEMPT,              /* Like TRACE_SWITCH, ARG was still runnable. */
+	TRACE_WAKEUP,               /* TID made ready. */
+	TRACE_SEMA_BLOCK,           /* TID blocked in sema_down() on ARG. */
+	TRACE_LOCK_WAIT,            /* TID started waiting for lock ARG. */
+	TRACE_LOCK_ACQUIRED,        /* TID got lock ARG it waited for. */
+};
+
+/* One trace event, as stored in the buffer and in dump files. */
+struct trace_event {
+	uint64_t tsc;               /* Time-stamp counter. */
+	uint64_t arg;               /* Type-specific argument: a tid, or the
+	                               kernel address of a semaphore or lock. */
+	int32_t tid;                /* Thread the event is about. */
+	uint8_t type;               /* A trace_type. */
+	uint8_t cpu;                /* CPU that recorded it. */
+	uint16_t pad;
+};
+
+/* Set by the "-trace" kernel command-line option. */
+extern bool trace_enabled;
+extern const char *trace_file;
+
+struct thread;
+struct lock;
+struct semaphore;
+
+void trace_init (void);
+void trace_switch (struct thread *prev, struct thread *next);
+void trace_wakeup (struct thread *);
+void trace_sema_block (struct semaphore *);
+void trace_lock_wait (struct lock *);
+void trace_lock_acquired (struct lock *);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
@@ -20,6 +20,12 @@
 #define PGSIZE  (1 << PGBITS)              /* Bytes in a page. */
 #define PGMASK  BITMASK(PGSHIFT, PGBITS)   /* Page offset bits (0:12). */
 
+/* Large page offset (bits 0:21), mapped by one page directory
+ * entry. */
+#define LPGBITS 21                         /* Number of offset bits. */
+#define LPGSIZE (1ul << LPGBITS)           /* Bytes in a large page. */
+#define LPGMASK BITMASK(PGSHIFT, LPGBITS)  /* Large page offset bits (0:21). */
+
 /* Offset within a page. */
 #define pg_ofs(va) ((uint64_t) (va) & PGMASK)
 
@@ -0,0 +1,66 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Function run by a work queue worker. */
+typedef void work_func (void *aux);
+
+/* Deferred work item.  Usually embedded in the object it works on.
+   Initialize with work_init(), then submit with work_submit(). */
+struct work {
+	struct list_elem elem;      /* Element in a pool's pending list. */
+	work_func *func;            /* Function to call. */
+	void *aux;                  /* Its argument. */
+	struct wq_pool *pool;       /* Pool it is pending on, or null. */
+	uint64_t queued_tsc;        /* Time-stamp counter at submission. */
+};
+
+/* Maximum workers per CPU in one work queue. */
+#define WQ_MAX_WORKERS 8
+
+/* Pending work of one queue on one CPU. */
+struct wq_pool {
+	struct workqueue *wq;       /* Owning queue. */
+	struct spinlock lock;       /* Protects the members below. */
+	struct list pending;        /* Submitted, not yet started. */
+	struct semaphore items;     /* Upped once per submission. */
+	int depth;                  /* Length of pending. */
+
+	/* Statistics. */
+	unsigned long long submitted;     /* Items submitted. */
+	unsigned long long executed;      /* Items run. */
+	unsigned long long cancelled;     /* Items cancelled before running. */
+	int max_depth;                    /* Greatest DEPTH seen. */
+	unsigned long long wait_cycles;   /* Total submit-to-start latency. */
+	unsigned long long max_wait_cycles; /* Worst submit-to-start latency. */
+};
+
+/* Work queue: a bounded set of kernel threads at one priority that
+   run submitted work items in FIFO order. */
+struct workqueue {
+	const char *name;           /* Name, for statistics and threads. */
+	int priority;               /* Priority of the workers. */
+	int workers;                /* Workers per CPU. */
+	struct wq_pool pools[NCPU]; /* Per-CPU pending work. */
+};
+
+/* Shared queues for work that has no queue of its own. */
+extern struct workqueue system_wq;      /* PRI_DEFAULT. */
+extern struct workqueue system_bg_wq;   /* Just above PRI_MIN, for idle-time work. */
+
+void workqueue_init (void);
+bool workqueue_create (struct workqueue *, const char *name, int priority,
+		int workers);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_submit (struct workqueue *, struct work *);
+bool work_cancel (struct work *);
+bool work_pending (const struct work *);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,13 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdbool.h>
+
+struct process;
+
+void futex_init (void);
+bool futex_wait (int *uaddr, int val);
+int futex_wake (int *uaddr, int cnt);
+void futex_wake_all (struct process *);
+
+#endif /* userprog/futex.h */
@@ -2,6 +2,31 @@
 #define USERPROG_PROCESS_H
 
 #include "threads/thread.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* 한 프로세스가 가질 수 있는 커널 할당 쓰레드 스택 수. */
+#define PROCESS_STACK_SLOTS 64
+
+/* 한 유저 프로그램의 쓰레드들이 공유하는 자원.
+ * 주소 공간과 열린 파일을 담고, 마지막 쓰레드가 종료할 때 해제된다. */
+struct process {
+	int thread_cnt;                     /* 이 프로세스를 쓰는 쓰레드 수. */
+	tid_t pid;                          /* 부모가 wait()하는 첫 쓰레드의 tid. */
+	struct thread *parent;              /* 종료 상태를 받을 쓰레드. */
+	bool exiting;                       /* exit()로 그룹 종료 중. */
+	struct semaphore exit_sema;         /* 나머지 쓰레드가 모두 나가면 up. */
+	struct list sleepers;               /* process_sleep()에서 자는 쓰레드. */
+	uint64_t stack_slots;               /* 사용 중인 쓰레드 스택 슬롯 비트맵. */
+	uint64_t *pml4;                     /* Page map level 4. */
+#ifdef VM
+	struct supplemental_page_table spt; /* 주소 공간 전체의 페이지 정보. */
+#endif
+	struct file *fdt[64];               /* 파일 디스크립터 테이블. */
+	int next_fd;
+	struct file *running_file;          /* rox: 실행 중인 파일. */
+};
 
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
@@ -9,6 +34,12 @@ int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+void process_cache_init (void);
+tid_t process_create_thread (void *entry, void *arg, void *stack);
+bool process_is_shared (void);
+bool process_begin_exit (void);
+void process_check_exit (void);
+void process_sleep (struct semaphore *);
 
 ///// -- fork -- /////
 struct f_thread
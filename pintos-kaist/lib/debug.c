@@ -28,3 +28,19 @@ debug_backtrace (void) {
 				"of the Pintos documentation for more information.\n");
 	}
 }
+
+/* Stores up to CNT addresses of the call stack in PCS, innermost
+   first, the same ones that debug_backtrace() would print.  The
+   first is in the caller of this function.  Returns the number
+   stored. */
+int
+debug_backtrace_save (void **pcs, int cnt) {
+	void **frame;
+	int n = 0;
+
+	for (frame = __builtin_frame_address (0);
+			frame != NULL && frame[0] != NULL && n < cnt;
+			frame = frame[0])
+		pcs[n++] = frame[1];
+	return n;
+}
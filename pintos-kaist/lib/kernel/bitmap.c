@@ -26,6 +26,7 @@ typedef unsigned long elem_type;
    simulates an array of bits. */
 struct bitmap {
 	size_t bit_cnt;     /* Number of bits. */
+	size_t next_fit;    /* Where bitmap_scan_and_flip_next() starts. */
 	elem_type *bits;    /* Elements that represent bits. */
 };
 
@@ -62,6 +63,69 @@ last_mask (const struct bitmap *b) {
 	int last_bits = b->bit_cnt % ELEM_BITS;
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns an elem_type in which the CNT bits starting at bit OFS
+   are set to 1 and the rest are set to 0.  OFS + CNT must not
+   exceed ELEM_BITS. */
+static inline elem_type
+range_mask (size_t ofs, size_t cnt) {
+	elem_type mask = cnt < ELEM_BITS ? ((elem_type) 1 << cnt) - 1 : (elem_type) -1;
+	return mask << ofs;
+}
+
+/* Returns the number of 1 bits in E.  The kernel is not linked
+   with libgcc, so __builtin_popcountl() is not available. */
+static inline size_t
+elem_popcount (elem_type e) {
+	e = e - ((e >> 1) & 0x5555555555555555UL);
+	e = (e & 0x3333333333333333UL) + ((e >> 2) & 0x3333333333333333UL);
+	e = (e + (e >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (e * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the number of bits, at most CNT, from bit START to the
+   end of its element. */
+static inline size_t
+elem_run (size_t start, size_t cnt) {
+	size_t left = ELEM_BITS - start % ELEM_BITS;
+	return left < cnt ? left : cnt;
+}
+
+/* Returns the index of the first bit in B at or after START and
+   before END that is set to VALUE, or END if there is none.
+
+   Works an element at a time: each element is XORed with FLIP so
+   that the bits sought are 1s, and the lowest one is found with a
+   count-trailing-zeros instruction.  Long stretches of the other
+   value are skipped four elements, 256 bits, at a time. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value) {
+	elem_type flip = value ? 0 : (elem_type) -1;
+	size_t idx, last;
+	elem_type e;
+
+	if (start >= end)
+		return end;
+
+	idx = elem_idx (start);
+	last = elem_idx (end - 1);
+	e = (b->bits[idx] ^ flip) & ((elem_type) -1 << (start % ELEM_BITS));
+	while (e == 0) {
+		idx++;
+		while (idx + 3 <= last
+				&& ((b->bits[idx] ^ flip) | (b->bits[idx + 1] ^ flip)
+					| (b->bits[idx + 2] ^ flip) | (b->bits[idx + 3] ^ flip)) == 0)
+			idx += 4;
+		if (idx > last)
+			return end;
+		e = b->bits[idx] ^ flip;
+	}
+
+	/* Bits past the end of B in its last element are 0, so a search
+	   for false can find one; END is never past the end of B. */
+	idx = idx * ELEM_BITS + __builtin_ctzl (e);
+	return idx < end ? idx : end;
+}
 
 /* Creation and destruction. */
 
@@ -74,6 +138,7 @@ bitmap_create (size_t bit_cnt) {
 	struct bitmap *b = malloc (sizeof *b);
 	if (b != NULL) {
 		b->bit_cnt = bit_cnt;
+		b->next_fit = 0;
 		b->bits = malloc (byte_cnt (bit_cnt));
 		if (b->bits != NULL || bit_cnt == 0) {
 			bitmap_set_all (b, false);
@@ -94,6 +159,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
 	ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
 	b->bit_cnt = bit_cnt;
+	b->next_fit = 0;
 	b->bits = (elem_type *) (b + 1);
 	bitmap_set_all (b, false);
 	return b;
@@ -194,17 +260,27 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, as by bitmap_mark() or
+   bitmap_reset(). */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	while (cnt > 0) {
+		size_t idx = elem_idx (start);
+		size_t n = elem_run (start, cnt);
+		elem_type mask = range_mask (start % ELEM_BITS, n);
+
+		if (value)
+			asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+		start += n;
+		cnt -= n;
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -217,27 +293,27 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
+	/* Count the true bits an element at a time. */
 	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	for (i = 0; i < cnt; ) {
+		size_t n = elem_run (start + i, cnt - i);
+		elem_type mask = range_mask ((start + i) % ELEM_BITS, n);
+
+		value_cnt += elem_popcount (b->bits[elem_idx (start + i)] & mask);
+		i += n;
+	}
+	return value ? value_cnt : cnt - value_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return find_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -266,18 +342,32 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+   Takes time linear in the number of elements searched, not in
+   CNT: from each bit set to VALUE it finds the end of the run,
+   and resumes the search past the end if the run is too short. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
+	if (cnt == 0)
+		return start;
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
+		size_t i = start;
+
+		while (i <= last) {
+			size_t end;
+
+			i = find_bit (b, i, last + 1, value);
+			if (i > last)
+				break;
+			end = find_bit (b, i, i + cnt, !value);
+			if (end == i + cnt)
 				return i;
+			i = end;
+		}
 	}
 	return BITMAP_ERROR;
 }
@@ -297,6 +387,27 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value) {
 	return idx;
 }
 
+/* Like bitmap_scan_and_flip(), but searches next-fit: starting
+   just past the group this function found last time, and wrapping
+   around to the beginning of B if nothing is found there.  This
+   keeps repeated allocations from rescanning the full part at the
+   start of B each time. */
+size_t
+bitmap_scan_and_flip_next (struct bitmap *b, size_t cnt, bool value) {
+	size_t idx;
+
+	ASSERT (b != NULL);
+
+	idx = bitmap_scan (b, b->next_fit, cnt, value);
+	if (idx == BITMAP_ERROR && b->next_fit > 0)
+		idx = bitmap_scan (b, 0, cnt, value);
+	if (idx != BITMAP_ERROR) {
+		bitmap_set_multiple (b, idx, cnt, !value);
+		b->next_fit = idx + cnt;
+	}
+	return idx;
+}
+
 /* File input and output. */
 
 #ifdef FILESYS
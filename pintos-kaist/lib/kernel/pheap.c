@@ -0,0 +1,160 @@
+#include "pheap.h"
+#include "../debug.h"
+
+/* Pairing heap.  See pheap.h for an overview.
+
+   The heap is a multiway tree in which every element comes out
+   no later than any of its children.  Each element points to its
+   leftmost child and to its right sibling; `prev' points to the
+   left sibling, or to the parent for a leftmost child, so that any
+   element can be cut out in O(1).
+
+   Two trees are combined ("melded") by making the root that comes
+   out later the leftmost child of the other.  Popping the root
+   melds its children in two passes, left to right in pairs and
+   then right to left, which gives the amortized O(log n) bound. */
+
+static struct pheap_elem *meld (struct pheap_elem *, struct pheap_elem *,
+                                pheap_less_func *, void *aux);
+static struct pheap_elem *merge_pairs (struct pheap_elem *,
+                                       pheap_less_func *, void *aux);
+
+/* Initializes HEAP as an empty heap. */
+void
+pheap_init (struct pheap *heap) {
+	ASSERT (heap != NULL);
+	heap->root = NULL;
+	heap->size = 0;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+pheap_empty (const struct pheap *heap) {
+	return heap->root == NULL;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+pheap_size (const struct pheap *heap) {
+	return heap->size;
+}
+
+/* Returns the element that would be popped next from HEAP, or a
+   null pointer if HEAP is empty. */
+struct pheap_elem *
+pheap_top (const struct pheap *heap) {
+	return heap->root;
+}
+
+/* Inserts ELEM into HEAP, ordered by LESS given auxiliary data
+   AUX.  O(1). */
+void
+pheap_push (struct pheap *heap, struct pheap_elem *elem,
+            pheap_less_func *less, void *aux) {
+	ASSERT (heap != NULL && elem != NULL && less != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	heap->root = heap->root != NULL ? meld (heap->root, elem, less, aux) : elem;
+	heap->size++;
+}
+
+/* Removes and returns the top element of HEAP, which must not be
+   empty. */
+struct pheap_elem *
+pheap_pop (struct pheap *heap, pheap_less_func *less, void *aux) {
+	struct pheap_elem *top;
+
+	ASSERT (!pheap_empty (heap));
+
+	top = heap->root;
+	heap->root = merge_pairs (top->child, less, aux);
+	heap->size--;
+	return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+pheap_remove (struct pheap *heap, struct pheap_elem *elem,
+              pheap_less_func *less, void *aux) {
+	struct pheap_elem *sub;
+
+	ASSERT (!pheap_empty (heap));
+
+	if (elem == heap->root) {
+		pheap_pop (heap, less, aux);
+		return;
+	}
+
+	/* Cut ELEM's subtree out of its parent's child list. */
+	ASSERT (elem->prev != NULL);
+	if (elem->prev->child == elem)
+		elem->prev->child = elem->next;
+	else
+		elem->prev->next = elem->next;
+	if (elem->next != NULL)
+		elem->next->prev = elem->prev;
+
+	/* Put its children back. */
+	sub = merge_pairs (elem->child, less, aux);
+	if (sub != NULL)
+		heap->root = meld (heap->root, sub, less, aux);
+	heap->size--;
+}
+
+/* Melds the trees rooted at A and B, neither of which has
+   siblings, and returns the root of the result. */
+static struct pheap_elem *
+meld (struct pheap_elem *a, struct pheap_elem *b,
+      pheap_less_func *less, void *aux) {
+	if (less (b, a, aux)) {
+		struct pheap_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	/* B becomes A's leftmost child. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	a->next = a->prev = NULL;
+	return a;
+}
+
+/* Melds the sibling list starting at FIRST into a single tree and
+   returns its root, or a null pointer if FIRST is null. */
+static struct pheap_elem *
+merge_pairs (struct pheap_elem *first, pheap_less_func *less, void *aux) {
+	struct pheap_elem *pairs = NULL;
+	struct pheap_elem *root = NULL;
+
+	/* Left to right: meld adjacent pairs, stacking the results. */
+	while (first != NULL) {
+		struct pheap_elem *a = first;
+		struct pheap_elem *b = a->next;
+
+		a->next = a->prev = NULL;
+		if (b == NULL) {
+			first = NULL;
+		} else {
+			first = b->next;
+			b->next = b->prev = NULL;
+			a = meld (a, b, less, aux);
+		}
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* Right to left: meld the stacked trees into one. */
+	while (pairs != NULL) {
+		struct pheap_elem *t = pairs;
+
+		pairs = t->next;
+		t->next = NULL;
+		root = root != NULL ? meld (root, t, less, aux) : t;
+	}
+	if (root != NULL)
+		root->prev = NULL;
+	return root;
+}
@@ -194,3 +194,34 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+getrusage (struct rusage *usage) {
+	return syscall1 (SYS_GETRUSAGE, usage);
+}
+
+bool
+sched_setdeadline (int64_t runtime, int64_t period, int64_t deadline) {
+	return syscall3 (SYS_SCHED_SETDEADLINE, runtime, period, deadline);
+}
+
+int
+futex_wait (int *uaddr, int val) {
+	return syscall2 (SYS_FUTEX_WAIT, uaddr, val);
+}
+
+int
+futex_wake (int *uaddr, int cnt) {
+	return syscall2 (SYS_FUTEX_WAKE, uaddr, cnt);
+}
+
+int
+thread_create (void (*entry) (void *), void *arg, void *stack) {
+	return syscall3 (SYS_THREAD_CREATE, entry, arg, stack);
+}
+
+void
+thread_exit (int *clear) {
+	syscall1 (SYS_THREAD_EXIT, clear);
+	NOT_REACHED ();
+}
@@ -0,0 +1,114 @@
+#include <uthread.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* Threads, mutexes and condition variables on top of futexes.
+
+   An uncontended lock or unlock is a single atomic instruction and
+   never enters the kernel.  Only a thread that has to wait calls
+   futex_wait(), and only an unlock that may have a waiter calls
+   futex_wake().  See Drepper, "Futexes Are Tricky", for the mutex
+   protocol. */
+
+/* Entry point of threads started by uthread_create(). */
+static void
+uthread_entry (void *self_) {
+	struct uthread *self = self_;
+
+	self->func (self->aux);
+	thread_exit (&self->running);
+}
+
+/* Starts a new thread running FUNC(AUX) on a stack allocated by
+   the kernel, and fills in T for uthread_join().  Returns 0 if
+   successful, -1 on failure. */
+int
+uthread_create (struct uthread *t, void (*func) (void *), void *aux) {
+	t->func = func;
+	t->aux = aux;
+
+	/* Set before the thread can run, so that its exit is never
+	   overwritten. */
+	t->running = 1;
+	t->tid = thread_create (uthread_entry, t, NULL);
+	if (t->tid < 0) {
+		t->running = 0;
+		return -1;
+	}
+	return 0;
+}
+
+/* Waits for thread T to exit. */
+void
+uthread_join (struct uthread *t) {
+	int running;
+
+	while ((running = __atomic_load_n (&t->running, __ATOMIC_ACQUIRE)) != 0)
+		futex_wait (&t->running, running);
+}
+
+/* Initializes M as unlocked. */
+void
+umutex_init (struct umutex *m) {
+	m->state = 0;
+}
+
+/* Acquires M, sleeping until it is available. */
+void
+umutex_lock (struct umutex *m) {
+	int c = 0;
+
+	if (__atomic_compare_exchange_n (&m->state, &c, 1, false,
+	                                 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	/* Contended.  Mark that there is a waiter before sleeping, so
+	   that the holder's unlock wakes us. */
+	if (c != 2)
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	while (c != 0) {
+		futex_wait (&m->state, 2);
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+/* Releases M, which the caller must hold. */
+void
+umutex_unlock (struct umutex *m) {
+	if (__atomic_fetch_sub (&m->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n (&m->state, 0, __ATOMIC_RELEASE);
+		futex_wake (&m->state, 1);
+	}
+}
+
+/* Initializes condition variable C. */
+void
+ucond_init (struct ucond *c) {
+	c->seq = 0;
+}
+
+/* Atomically releases M and waits for C to be signaled, then
+   reacquires M.  As with the kernel's cond_wait(), the condition
+   must be rechecked after returning. */
+void
+ucond_wait (struct ucond *c, struct umutex *m) {
+	int seq = __atomic_load_n (&c->seq, __ATOMIC_RELAXED);
+
+	umutex_unlock (m);
+	futex_wait (&c->seq, seq);
+	umutex_lock (m);
+}
+
+/* Wakes one thread waiting on C, if any. */
+void
+ucond_signal (struct ucond *c) {
+	__atomic_fetch_add (&c->seq, 1, __ATOMIC_RELEASE);
+	futex_wake (&c->seq, 1);
+}
+
+/* Wakes all threads waiting on C. */
+void
+ucond_broadcast (struct ucond *c) {
+	__atomic_fetch_add (&c->seq, 1, __ATOMIC_RELEASE);
+	futex_wake (&c->seq, INT_MAX);
+}
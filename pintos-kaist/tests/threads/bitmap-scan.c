@@ -0,0 +1,156 @@
+/* Checks the word-at-a-time bitmap routines against a plain array
+   of bools.  Sets random, mostly unaligned ranges of a map whose
+   size is not a multiple of the word size, and after each change
+   compares bitmap_count() and bitmap_scan() on random ranges with
+   bit-at-a-time answers.  Then checks that
+   bitmap_scan_and_flip_next() resumes past its last group and
+   wraps around to the start of the map. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+
+/* Number of bits in the map used for the random operations. */
+#define BIT_CNT 1000
+
+/* Number of random operations. */
+#define OP_CNT 2000
+
+/* Longest range set by a single operation. */
+#define MAX_RUN 150
+
+static bool ref[BIT_CNT];
+
+static size_t
+ref_count (size_t start, size_t cnt, bool value)
+{
+  size_t i, value_cnt = 0;
+
+  for (i = start; i < start + cnt; i++)
+    if (ref[i] == value)
+      value_cnt++;
+  return value_cnt;
+}
+
+static size_t
+ref_scan (size_t start, size_t cnt, bool value)
+{
+  size_t i, run = 0;
+
+  if (cnt == 0)
+    return start;
+  for (i = start; i < BIT_CNT; i++)
+    {
+      run = ref[i] == value ? run + 1 : 0;
+      if (run == cnt)
+        return i + 1 - cnt;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Returns a random number between 0 and MAX, inclusive. */
+static size_t
+random_upto (size_t max)
+{
+  return random_ulong () % (max + 1);
+}
+
+static void
+test_random_ops (void)
+{
+  struct bitmap *b;
+  size_t i;
+  int op;
+
+  b = bitmap_create (BIT_CNT);
+  if (b == NULL)
+    fail ("bitmap_create failed");
+
+  random_init (0);
+  for (op = 0; op < OP_CNT; op++)
+    {
+      size_t start = random_upto (BIT_CNT);
+      size_t cnt = random_upto (BIT_CNT - start < MAX_RUN
+                                ? BIT_CNT - start : MAX_RUN);
+      bool value = random_ulong () % 2;
+
+      bitmap_set_multiple (b, start, cnt, value);
+      for (i = start; i < start + cnt; i++)
+        ref[i] = value;
+
+      start = random_upto (BIT_CNT);
+      cnt = random_upto (BIT_CNT - start);
+      value = random_ulong () % 2;
+      if (bitmap_count (b, start, cnt, value) != ref_count (start, cnt, value))
+        fail ("op %d: bitmap_count (%zu, %zu, %d) is %zu, expected %zu",
+              op, start, cnt, value, bitmap_count (b, start, cnt, value),
+              ref_count (start, cnt, value));
+
+      start = random_upto (BIT_CNT);
+      cnt = random_upto (MAX_RUN / 2);
+      if (bitmap_scan (b, start, cnt, value) != ref_scan (start, cnt, value))
+        fail ("op %d: bitmap_scan (%zu, %zu, %d) is %zu, expected %zu",
+              op, start, cnt, value, bitmap_scan (b, start, cnt, value),
+              ref_scan (start, cnt, value));
+    }
+
+  for (i = 0; i < BIT_CNT; i++)
+    if (bitmap_test (b, i) != ref[i])
+      fail ("bit %zu is %d, expected %d", i, bitmap_test (b, i), ref[i]);
+  bitmap_destroy (b);
+  msg ("%d random operations matched the reference.", OP_CNT);
+}
+
+static void
+check_next (struct bitmap *b, size_t cnt, size_t expected)
+{
+  size_t idx = bitmap_scan_and_flip_next (b, cnt, false);
+
+  if (idx != expected)
+    fail ("bitmap_scan_and_flip_next (%zu) returned %zu, expected %zu",
+          cnt, idx, expected);
+}
+
+static void
+test_next_fit (void)
+{
+  struct bitmap *b;
+
+  b = bitmap_create (100);
+  if (b == NULL)
+    fail ("bitmap_create failed");
+
+  check_next (b, 30, 0);
+  check_next (b, 30, 30);
+  check_next (b, 30, 60);
+  check_next (b, 30, BITMAP_ERROR);
+  msg ("Next-fit handed out consecutive groups.");
+
+  /* Bits 90...99 are too few for 20, so the search from bit 90
+     must wrap around to find bits 10...39. */
+  bitmap_set_multiple (b, 10, 30, false);
+  check_next (b, 20, 10);
+  msg ("Next-fit wrapped around to the start.");
+
+  /* Bits 0...4 are free too, but next-fit resumes at bit 30 and
+     only comes back to them after the end of the map. */
+  bitmap_set_multiple (b, 0, 5, false);
+  check_next (b, 5, 30);
+  check_next (b, 5, 35);
+  check_next (b, 5, 90);
+  check_next (b, 5, 95);
+  check_next (b, 5, 0);
+  if (bitmap_count (b, 0, 100, false) != 0)
+    fail ("%zu bits still free", bitmap_count (b, 0, 100, false));
+  bitmap_destroy (b);
+  msg ("Next-fit resumed past its last group.");
+}
+
+void
+test_bitmap_scan (void)
+{
+  test_random_ops ();
+  test_next_fit ();
+}
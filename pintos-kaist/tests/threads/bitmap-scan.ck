@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(bitmap-scan) begin
+(bitmap-scan) 2000 random operations matched the reference.
+(bitmap-scan) Next-fit handed out consecutive groups.
+(bitmap-scan) Next-fit wrapped around to the start.
+(bitmap-scan) Next-fit resumed past its last group.
+(bitmap-scan) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Measures how often cond_broadcast() switches away from the
+   broadcasting thread.  Ten threads of higher priority than the
+   main thread wait on a condition.  Waking each of them used to
+   preempt the main thread once per waiter; with wakeups batched
+   the main thread is preempted once, after all of them are
+   ready. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define WAITER_CNT 10
+
+static thread_func waiter_thread;
+static struct lock lock;
+static struct condition condition;
+static int woken;
+
+void
+test_condvar_broadcast_batch (void) 
+{
+  uint64_t before, after;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  cond_init (&condition);
+
+  for (i = 0; i < WAITER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_DEFAULT + 1, waiter_thread, NULL);
+    }
+
+  lock_acquire (&lock);
+  before = thread_current ()->invol_switches;
+  cond_broadcast (&condition, &lock);
+  after = thread_current ()->invol_switches;
+  msg ("Broadcast to %d waiters preempted main %llu time(s).",
+       WAITER_CNT, (unsigned long long) (after - before));
+  lock_release (&lock);
+
+  msg ("%d waiters woke up.", woken);
+}
+
+static void
+waiter_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  cond_wait (&condition, &lock);
+  woken++;
+  lock_release (&lock);
+}
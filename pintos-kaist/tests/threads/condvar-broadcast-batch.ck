@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(condvar-broadcast-batch) begin
+(condvar-broadcast-batch) Broadcast to 10 waiters preempted main 1 time(s).
+(condvar-broadcast-batch) 10 waiters woke up.
+(condvar-broadcast-batch) end
+EOF
+pass;
@@ -0,0 +1,56 @@
+/* Checks admission control of the deadline scheduling class and
+   that a thread with budget left runs ahead of a PRI_MAX thread.
+
+   The main thread reserves 10% of the CPU.  It then creates a
+   PRI_MAX thread, which must not preempt it, and a thread that
+   asks for 90% and is refused because the total would exceed the
+   95% limit, then settles for 50%.  Both children only get to run
+   once the main thread sleeps. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func hog_func;
+static thread_func greedy_func;
+
+void
+test_deadline_admit (void) 
+{
+  if (!thread_set_deadline (10, 100, 100))
+    fail ("main not admitted at 10%%");
+  msg ("main admitted at 10%%.");
+
+  if (thread_set_deadline (1, 10, 20))
+    fail ("deadline after period accepted");
+  if (thread_set_deadline (1LL << 44, 1LL << 44, 1LL << 44))
+    fail ("out-of-range period accepted");
+
+  thread_create ("hog", PRI_MAX, hog_func, NULL);
+  msg ("main still running after creating hog.");
+  thread_create ("greedy", PRI_DEFAULT, greedy_func, NULL);
+  msg ("main sleeping.");
+
+  timer_sleep (10);
+  msg ("main leaving deadline class.");
+  thread_set_deadline (0, 0, 0);
+}
+
+static void
+hog_func (void *aux UNUSED) 
+{
+  msg ("hog running.");
+}
+
+static void
+greedy_func (void *aux UNUSED) 
+{
+  if (thread_set_deadline (90, 100, 100))
+    fail ("greedy admitted at 90%%");
+  msg ("greedy refused at 90%%.");
+  if (!thread_set_deadline (50, 100, 100))
+    fail ("greedy not admitted at 50%%");
+  msg ("greedy admitted at 50%%.");
+}
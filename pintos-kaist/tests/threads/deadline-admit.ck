@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-admit) begin
+(deadline-admit) main admitted at 10%.
+(deadline-admit) main still running after creating hog.
+(deadline-admit) main sleeping.
+(deadline-admit) hog running.
+(deadline-admit) greedy refused at 90%.
+(deadline-admit) greedy admitted at 50%.
+(deadline-admit) main leaving deadline class.
+(deadline-admit) end
+EOF
+pass;
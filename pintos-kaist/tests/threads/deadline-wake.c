@@ -0,0 +1,44 @@
+/* Checks that a deadline thread woken by sema_up() preempts a
+   running thread of higher priority that is not in the deadline
+   class.
+
+   A PRI_MIN thread joins the deadline class and blocks on a
+   semaphore.  When the PRI_DEFAULT main thread ups the semaphore,
+   the deadline thread must run before sema_up() returns. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func dl_func;
+static struct semaphore started, wake;
+
+void
+test_deadline_wake (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&started, 0);
+  sema_init (&wake, 0);
+  thread_create ("dl", PRI_MIN, dl_func, NULL);
+  sema_down (&started);
+
+  msg ("main waking dl.");
+  sema_up (&wake);
+  msg ("main running again.");
+}
+
+static void
+dl_func (void *aux UNUSED) 
+{
+  if (!thread_set_deadline (10, 100, 100))
+    fail ("dl not admitted at 10%%");
+  msg ("dl admitted at 10%%.");
+  sema_up (&started);
+  sema_down (&wake);
+  msg ("dl woke up.");
+  thread_set_deadline (0, 0, 0);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-wake) begin
+(deadline-wake) dl admitted at 10%.
+(deadline-wake) main waking dl.
+(deadline-wake) dl woke up.
+(deadline-wake) main running again.
+(deadline-wake) end
+EOF
+pass;
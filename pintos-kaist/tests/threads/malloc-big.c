@@ -0,0 +1,115 @@
+/* Allocates and frees buffers of random sizes between 3 kB and
+   64 kB, first straight from the page allocator, as malloc() used
+   to do, and then with malloc(), and reports the average cost of
+   each in cycles.  Then checks that realloc() keeps the contents
+   of a big block as it grows and shrinks. */
+
+#include <random.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#define SLOT_CNT 16
+#define OP_CNT 4096
+#define MIN_SIZE (3 * 1024)
+#define MAX_SIZE (64 * 1024)
+
+static void *slots[SLOT_CNT];
+static size_t slot_pages[SLOT_CNT];
+
+/* Runs OP_CNT operations, each of which frees a random slot if it
+   is in use or fills it otherwise, and returns the average number
+   of cycles per operation. */
+static unsigned long long
+run (bool use_malloc) 
+{
+  uint64_t start;
+  int i;
+
+  random_init (0);
+  start = rdtsc ();
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      int slot = random_ulong () % SLOT_CNT;
+
+      if (slots[slot] != NULL) 
+        {
+          if (use_malloc)
+            free (slots[slot]);
+          else
+            palloc_free_multiple (slots[slot], slot_pages[slot]);
+          slots[slot] = NULL;
+        }
+      else 
+        {
+          size_t size = MIN_SIZE + random_ulong () % (MAX_SIZE - MIN_SIZE + 1);
+
+          slot_pages[slot] = DIV_ROUND_UP (size, PGSIZE);
+          slots[slot] = (use_malloc
+                         ? malloc (size)
+                         : palloc_get_multiple (0, slot_pages[slot]));
+          if (slots[slot] == NULL)
+            fail ("allocation of %zu bytes failed", size);
+          *(char *) slots[slot] = 1;
+        }
+    }
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i] != NULL) 
+      {
+        if (use_malloc)
+          free (slots[i]);
+        else
+          palloc_free_multiple (slots[i], slot_pages[i]);
+        slots[i] = NULL;
+      }
+  return (rdtsc () - start) / OP_CNT;
+}
+
+/* Checks that the first SIZE bytes of P hold their pattern. */
+static void
+check_pattern (const unsigned char *p, size_t size) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != (unsigned char) (i * 7))
+      fail ("byte %zu changed", i);
+}
+
+void
+test_malloc_big (void) 
+{
+  static const size_t sizes[] = {4 * PGSIZE, 12 * PGSIZE, 40 * PGSIZE,
+                                 2 * PGSIZE, 1000};
+  unsigned char *p;
+  size_t old_size, i;
+
+  msg ("palloc: %llu cycles per operation.", run (false));
+  msg ("malloc: %llu cycles per operation.", run (true));
+
+  old_size = 3 * PGSIZE;
+  p = malloc (old_size);
+  for (i = 0; i < old_size; i++)
+    p[i] = i * 7;
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    {
+      size_t new_size = sizes[i];
+      size_t j;
+
+      p = realloc (p, new_size);
+      if (p == NULL)
+        fail ("realloc to %zu bytes failed", new_size);
+      check_pattern (p, old_size < new_size ? old_size : new_size);
+      for (j = 0; j < new_size; j++)
+        p[j] = j * 7;
+      old_size = new_size;
+    }
+  free (p);
+  msg ("realloc kept the contents.");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing palloc timing in output"
+  unless grep (/^\(malloc-big\) palloc: \d+ cycles per operation\.$/, @output);
+fail "missing malloc timing in output"
+  unless grep (/^\(malloc-big\) malloc: \d+ cycles per operation\.$/, @output);
+fail "missing realloc check in output"
+  unless grep ($_ eq '(malloc-big) realloc kept the contents.', @output);
+
+pass;
@@ -0,0 +1,85 @@
+/* Has several threads allocate, fill, check, and free blocks of
+   every small size class, so that blocks move back and forth
+   between the per-CPU magazines and the shared free lists, and
+   checks that no block is handed out twice. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 4
+#define BLOCK_CNT 64
+#define ROUND_CNT 8
+
+struct worker
+  {
+    int id;
+    struct semaphore done;
+    bool ok;
+  };
+
+static struct worker workers[THREAD_CNT];
+
+static void
+worker_func (void *aux) 
+{
+  struct worker *w = aux;
+  unsigned char *blocks[BLOCK_CNT];
+  int round, i;
+
+  w->ok = true;
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      for (i = 0; i < BLOCK_CNT; i++) 
+        {
+          size_t size = 16 << (i % 7);
+          blocks[i] = malloc (size);
+          if (blocks[i] == NULL)
+            w->ok = false;
+          else
+            memset (blocks[i], w->id * BLOCK_CNT + i, size);
+        }
+      thread_yield ();
+      for (i = 0; i < BLOCK_CNT; i++) 
+        {
+          size_t size = 16 << (i % 7);
+          unsigned char byte = w->id * BLOCK_CNT + i;
+          size_t j;
+
+          if (blocks[i] == NULL)
+            continue;
+          for (j = 0; j < size; j++)
+            if (blocks[i][j] != byte)
+              w->ok = false;
+          free (blocks[i]);
+        }
+    }
+  sema_up (&w->done);
+}
+
+void
+test_malloc_magazine (void) 
+{
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+
+      workers[i].id = i;
+      sema_init (&workers[i].done, 0);
+      snprintf (name, sizeof name, "worker %d", i);
+      thread_create (name, PRI_DEFAULT, worker_func, &workers[i]);
+    }
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      sema_down (&workers[i].done);
+      if (!workers[i].ok)
+        fail ("worker %d saw a corrupted block", i);
+    }
+  msg ("%d threads made %d rounds without overlap.", THREAD_CNT, ROUND_CNT);
+}
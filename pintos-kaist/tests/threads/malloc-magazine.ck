@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-magazine) begin
+(malloc-magazine) 4 threads made 8 rounds without overlap.
+(malloc-magazine) end
+EOF
+pass;
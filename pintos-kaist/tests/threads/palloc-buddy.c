@@ -0,0 +1,49 @@
+/* Allocates runs of 1 to 17 pages, tags every page with the run
+   it belongs to, and checks that no run was handed a page that
+   another run also got.  Then frees the runs in a scrambled order
+   and does it again, so that later rounds reuse merged blocks. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define RUN_CNT 48
+#define ROUND_CNT 3
+
+static uint8_t *runs[RUN_CNT];
+
+/* Pages in run I. */
+static size_t
+run_pages (int i) 
+{
+  return 1 + (i * 7) % 17;
+}
+
+void
+test_palloc_buddy (void) 
+{
+  int round, i;
+  size_t j;
+
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      for (i = 0; i < RUN_CNT; i++) 
+        {
+          runs[i] = palloc_get_multiple (PAL_ASSERT, run_pages (i));
+          for (j = 0; j < run_pages (i); j++)
+            *(int *) (runs[i] + j * PGSIZE) = i;
+        }
+      for (i = 0; i < RUN_CNT; i++)
+        for (j = 0; j < run_pages (i); j++)
+          if (*(int *) (runs[i] + j * PGSIZE) != i)
+            fail ("round %d: page %zu of run %d was reused", round, j, i);
+      for (i = 0; i < RUN_CNT; i++) 
+        {
+          int k = (i * 11 + round) % RUN_CNT;
+          palloc_free_multiple (runs[k], run_pages (k));
+        }
+      msg ("Round %d: %d runs did not overlap.", round, RUN_CNT);
+    }
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Round 0: 48 runs did not overlap.
+(palloc-buddy) Round 1: 48 runs did not overlap.
+(palloc-buddy) Round 2: 48 runs did not overlap.
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,63 @@
+/* Dirties a batch of pages, frees them, gives the background
+   worker time to refill the zeroed-page stash, and then checks
+   that PAL_ZERO pages come back fully zeroed, both while the
+   stash lasts and after it runs out, and that the stash did
+   serve some of them. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 128
+
+static void *pages[PAGE_CNT];
+
+static bool
+page_is_zero (const void *page) 
+{
+  const uint64_t *p = page;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *p; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
+
+void
+test_palloc_zero (void) 
+{
+  unsigned long long hits;
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      pages[i] = palloc_get_page (PAL_ASSERT);
+      memset (pages[i], 0xa5, PGSIZE);
+    }
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+
+  /* Let the background worker run. */
+  timer_sleep (10);
+
+  hits = palloc_zero_hits (0);
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      pages[i] = palloc_get_page (PAL_ZERO | PAL_ASSERT);
+      if (!page_is_zero (pages[i]))
+        fail ("page %d is not zeroed", i);
+    }
+  hits = palloc_zero_hits (0) - hits;
+  if (hits == 0)
+    fail ("no PAL_ZERO page came from the zeroed-page stash");
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+  msg ("%d PAL_ZERO pages were zeroed.", PAGE_CNT);
+  msg ("The zeroed-page stash served some of them.");
+}
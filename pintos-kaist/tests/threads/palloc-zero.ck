@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) 128 PAL_ZERO pages were zeroed.
+(palloc-zero) The zeroed-page stash served some of them.
+(palloc-zero) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Checks that a thread whose donated priority drops while it
+   enters cond_wait() is queued on the condition at its new
+   priority.
+
+   A PRI_DEFAULT + 2 thread waits on a condition.  The main thread
+   then takes the monitor lock, receives a donation of
+   PRI_DEFAULT + 9 from a thread that blocks on the lock, and waits
+   on the condition too, which drops it back to PRI_DEFAULT.  The
+   donor signals once: the other waiter outranks the main thread
+   and must be the one woken. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func waiter_thread_func;
+static thread_func donor_thread_func;
+static struct lock lock;
+static struct condition condition;
+
+void
+test_priority_condvar_donate (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&lock);
+  cond_init (&condition);
+
+  thread_create ("waiter", PRI_DEFAULT + 2, waiter_thread_func, NULL);
+
+  lock_acquire (&lock);
+  thread_create ("donor", PRI_DEFAULT + 9, donor_thread_func, NULL);
+  msg ("main waiting with priority %d.", thread_get_priority ());
+  cond_wait (&condition, &lock);
+  msg ("main woke with priority %d.", thread_get_priority ());
+  lock_release (&lock);
+}
+
+static void
+waiter_thread_func (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  msg ("waiter waiting.");
+  cond_wait (&condition, &lock);
+  msg ("waiter woke.");
+  cond_signal (&condition, &lock);
+  lock_release (&lock);
+}
+
+static void
+donor_thread_func (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  cond_signal (&condition, &lock);
+  msg ("donor signalled.");
+  lock_release (&lock);
+  msg ("donor done.");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-condvar-donate) begin
+(priority-condvar-donate) waiter waiting.
+(priority-condvar-donate) main waiting with priority 40.
+(priority-condvar-donate) donor signalled.
+(priority-condvar-donate) donor done.
+(priority-condvar-donate) waiter woke.
+(priority-condvar-donate) main woke with priority 31.
+(priority-condvar-donate) end
+EOF
+pass;
@@ -0,0 +1,73 @@
+/* The main thread sets its priority to PRI_MIN, acquires lock 0,
+   and creates threads 1..20 with priorities PRI_MIN + 2, 4, ...,
+   40.  Thread i acquires lock i and then blocks on lock i - 1, so
+   the threads form a chain of 20 locks ending at the main thread.
+   Every new thread's priority must reach the main thread, however
+   long the chain has grown.
+
+   When the main thread releases lock 0, thread 1 gets it and
+   releases both of its locks, which wakes thread 2, and so on.
+   Each thread keeps the donation of the whole chain until it
+   releases its own lock. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define CHAIN_LENGTH 20
+
+struct lock_pair
+  {
+    struct lock *own;
+    struct lock *wait;
+  };
+
+static thread_func chain_thread_func;
+
+void
+test_priority_donate_deep (void) 
+{
+  struct lock locks[CHAIN_LENGTH + 1];
+  struct lock_pair pairs[CHAIN_LENGTH + 1];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MIN);
+
+  for (i = 0; i <= CHAIN_LENGTH; i++)
+    lock_init (&locks[i]);
+  lock_acquire (&locks[0]);
+
+  for (i = 1; i <= CHAIN_LENGTH; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "thread %d", i);
+      pairs[i].own = &locks[i];
+      pairs[i].wait = &locks[i - 1];
+      thread_create (name, PRI_MIN + i * 2, chain_thread_func, &pairs[i]);
+      msg ("main should have priority %d.  Actual priority: %d.",
+           PRI_MIN + i * 2, thread_get_priority ());
+    }
+
+  lock_release (&locks[0]);
+  msg ("main finishing with priority %d.", thread_get_priority ());
+}
+
+static void
+chain_thread_func (void *pair_) 
+{
+  struct lock_pair *pair = pair_;
+
+  lock_acquire (pair->own);
+  lock_acquire (pair->wait);
+  msg ("%s got lock", thread_name ());
+  lock_release (pair->wait);
+  lock_release (pair->own);
+  msg ("%s finishing with priority %d.", thread_name (),
+       thread_get_priority ());
+}
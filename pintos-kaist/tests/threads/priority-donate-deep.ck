@@ -0,0 +1,70 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-deep) begin
+(priority-donate-deep) main should have priority 2.  Actual priority: 2.
+(priority-donate-deep) main should have priority 4.  Actual priority: 4.
+(priority-donate-deep) main should have priority 6.  Actual priority: 6.
+(priority-donate-deep) main should have priority 8.  Actual priority: 8.
+(priority-donate-deep) main should have priority 10.  Actual priority: 10.
+(priority-donate-deep) main should have priority 12.  Actual priority: 12.
+(priority-donate-deep) main should have priority 14.  Actual priority: 14.
+(priority-donate-deep) main should have priority 16.  Actual priority: 16.
+(priority-donate-deep) main should have priority 18.  Actual priority: 18.
+(priority-donate-deep) main should have priority 20.  Actual priority: 20.
+(priority-donate-deep) main should have priority 22.  Actual priority: 22.
+(priority-donate-deep) main should have priority 24.  Actual priority: 24.
+(priority-donate-deep) main should have priority 26.  Actual priority: 26.
+(priority-donate-deep) main should have priority 28.  Actual priority: 28.
+(priority-donate-deep) main should have priority 30.  Actual priority: 30.
+(priority-donate-deep) main should have priority 32.  Actual priority: 32.
+(priority-donate-deep) main should have priority 34.  Actual priority: 34.
+(priority-donate-deep) main should have priority 36.  Actual priority: 36.
+(priority-donate-deep) main should have priority 38.  Actual priority: 38.
+(priority-donate-deep) main should have priority 40.  Actual priority: 40.
+(priority-donate-deep) thread 1 got lock
+(priority-donate-deep) thread 2 got lock
+(priority-donate-deep) thread 3 got lock
+(priority-donate-deep) thread 4 got lock
+(priority-donate-deep) thread 5 got lock
+(priority-donate-deep) thread 6 got lock
+(priority-donate-deep) thread 7 got lock
+(priority-donate-deep) thread 8 got lock
+(priority-donate-deep) thread 9 got lock
+(priority-donate-deep) thread 10 got lock
+(priority-donate-deep) thread 11 got lock
+(priority-donate-deep) thread 12 got lock
+(priority-donate-deep) thread 13 got lock
+(priority-donate-deep) thread 14 got lock
+(priority-donate-deep) thread 15 got lock
+(priority-donate-deep) thread 16 got lock
+(priority-donate-deep) thread 17 got lock
+(priority-donate-deep) thread 18 got lock
+(priority-donate-deep) thread 19 got lock
+(priority-donate-deep) thread 20 got lock
+(priority-donate-deep) thread 20 finishing with priority 40.
+(priority-donate-deep) thread 19 finishing with priority 38.
+(priority-donate-deep) thread 18 finishing with priority 36.
+(priority-donate-deep) thread 17 finishing with priority 34.
+(priority-donate-deep) thread 16 finishing with priority 32.
+(priority-donate-deep) thread 15 finishing with priority 30.
+(priority-donate-deep) thread 14 finishing with priority 28.
+(priority-donate-deep) thread 13 finishing with priority 26.
+(priority-donate-deep) thread 12 finishing with priority 24.
+(priority-donate-deep) thread 11 finishing with priority 22.
+(priority-donate-deep) thread 10 finishing with priority 20.
+(priority-donate-deep) thread 9 finishing with priority 18.
+(priority-donate-deep) thread 8 finishing with priority 16.
+(priority-donate-deep) thread 7 finishing with priority 14.
+(priority-donate-deep) thread 6 finishing with priority 12.
+(priority-donate-deep) thread 5 finishing with priority 10.
+(priority-donate-deep) thread 4 finishing with priority 8.
+(priority-donate-deep) thread 3 finishing with priority 6.
+(priority-donate-deep) thread 2 finishing with priority 4.
+(priority-donate-deep) thread 1 finishing with priority 2.
+(priority-donate-deep) main finishing with priority 0.
+(priority-donate-deep) end
+EOF
+pass;
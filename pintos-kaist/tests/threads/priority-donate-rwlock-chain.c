@@ -0,0 +1,71 @@
+/* The main thread write-acquires a reader-writer lock.  A
+   higher-priority "holder" thread acquires a plain lock and then
+   blocks trying to read-acquire the reader-writer lock, donating
+   its priority to the main thread.  A still higher-priority
+   "waiter" thread then blocks on the plain lock.  Its donation
+   must reach the main thread through the holder, which is waiting
+   on the reader-writer lock rather than on a plain lock. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct locks 
+  {
+    struct rwlock rw;
+    struct lock lock;
+  };
+
+static thread_func holder_thread_func;
+static thread_func waiter_thread_func;
+
+void
+test_priority_donate_rwlock_chain (void) 
+{
+  struct locks locks;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&locks.rw);
+  lock_init (&locks.lock);
+  rwlock_acquire_write (&locks.rw);
+  thread_create ("holder", PRI_DEFAULT + 3, holder_thread_func, &locks);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 3, thread_get_priority ());
+  thread_create ("waiter", PRI_DEFAULT + 6, waiter_thread_func, &locks);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 6, thread_get_priority ());
+  rwlock_release_write (&locks.rw);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+holder_thread_func (void *locks_) 
+{
+  struct locks *locks = locks_;
+
+  lock_acquire (&locks->lock);
+  rwlock_acquire_read (&locks->rw);
+  msg ("holder: got the rwlock");
+  rwlock_release_read (&locks->rw);
+  lock_release (&locks->lock);
+  msg ("holder: done");
+}
+
+static void
+waiter_thread_func (void *locks_) 
+{
+  struct locks *locks = locks_;
+
+  lock_acquire (&locks->lock);
+  msg ("waiter: got the lock");
+  lock_release (&locks->lock);
+  msg ("waiter: done");
+}
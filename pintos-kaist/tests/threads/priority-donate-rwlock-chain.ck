@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock-chain) begin
+(priority-donate-rwlock-chain) Main should have priority 34.  Actual priority: 34.
+(priority-donate-rwlock-chain) Main should have priority 37.  Actual priority: 37.
+(priority-donate-rwlock-chain) holder: got the rwlock
+(priority-donate-rwlock-chain) waiter: got the lock
+(priority-donate-rwlock-chain) waiter: done
+(priority-donate-rwlock-chain) holder: done
+(priority-donate-rwlock-chain) Main should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock-chain) end
+EOF
+pass;
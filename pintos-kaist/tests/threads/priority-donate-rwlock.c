@@ -0,0 +1,64 @@
+/* The main thread read-acquires a reader-writer lock.  Then it
+   creates a higher-priority writer that blocks on the lock, and a
+   still higher-priority reader that blocks behind the waiting
+   writer, since writers are preferred.  Both donate their
+   priorities to the main thread, which is only a reader.
+
+   When the main thread releases the lock, the waiting reader
+   outranks the waiting writer, so it gets the lock first, then
+   the writer.  The main thread drops back to its own priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_priority_donate_rwlock (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+  thread_create ("writer", PRI_DEFAULT + 5, writer_thread_func, &rw);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  thread_create ("reader", PRI_DEFAULT + 6, reader_thread_func, &rw);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 6, thread_get_priority ());
+  rwlock_release_read (&rw);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("reader: got the lock");
+  rwlock_release_read (rw);
+  msg ("reader: done");
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("writer: got the lock");
+  rwlock_release_write (rw);
+  msg ("writer: done");
+}
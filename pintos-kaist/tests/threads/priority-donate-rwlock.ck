@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock) begin
+(priority-donate-rwlock) Main should have priority 36.  Actual priority: 36.
+(priority-donate-rwlock) Main should have priority 37.  Actual priority: 37.
+(priority-donate-rwlock) reader: got the lock
+(priority-donate-rwlock) reader: done
+(priority-donate-rwlock) writer: got the lock
+(priority-donate-rwlock) writer: done
+(priority-donate-rwlock) Main should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock) end
+EOF
+pass;
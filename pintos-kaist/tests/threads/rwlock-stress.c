@@ -0,0 +1,122 @@
+/* Creates READER_CNT readers and WRITER_CNT writers at assorted
+   priorities, all below the main thread's, that hammer one
+   reader-writer lock.  Inside the lock each thread yields or
+   sleeps to let the others pile up behind it, which exercises
+   writer preference, hand-off to groups of readers and priority
+   donation to multiple readers.  Checks that a writer never
+   shares the lock, that every write happened and that all
+   donated priority is returned. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 6
+#define WRITER_CNT 4
+#define ITERATIONS 25
+
+static struct rwlock rw;
+static struct semaphore done;
+static int readers_in;          /* Readers inside the lock. */
+static int writers_in;          /* Writers inside the lock. */
+static int writes;              /* Completed writes. */
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_stress (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  sema_init (&done, 0);
+  for (i = 0; i < READER_CNT + WRITER_CNT; i++) 
+    {
+      char name[16];
+      int priority = PRI_DEFAULT - 1 - i % 4;
+
+      if (i % 2 == 0 && i / 2 < WRITER_CNT)
+        {
+          snprintf (name, sizeof name, "writer %d", i / 2);
+          thread_create (name, priority, writer_thread_func, NULL);
+        }
+      else
+        {
+          snprintf (name, sizeof name, "reader %d", i);
+          thread_create (name, priority, reader_thread_func, NULL);
+        }
+    }
+
+  for (i = 0; i < READER_CNT + WRITER_CNT; i++)
+    sema_down (&done);
+
+  if (readers_in != 0 || writers_in != 0)
+    fail ("%d readers and %d writers left inside the lock",
+          readers_in, writers_in);
+  msg ("%d threads finished, %d writes.",
+       READER_CNT + WRITER_CNT, writes);
+  msg ("Main should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+reader_thread_func (void *aux UNUSED) 
+{
+  int base = thread_get_priority ();
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      rwlock_acquire_read (&rw);
+      readers_in++;
+      if (writers_in != 0)
+        fail ("%s: reading while a writer holds the lock", thread_name ());
+      if (i % 5 == 0)
+        timer_sleep (1);
+      else
+        thread_yield ();
+      readers_in--;
+      rwlock_release_read (&rw);
+    }
+  if (thread_get_priority () != base)
+    fail ("%s: priority %d after release, expected %d",
+          thread_name (), thread_get_priority (), base);
+  sema_up (&done);
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  int base = thread_get_priority ();
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      rwlock_acquire_write (&rw);
+      if (writers_in++ != 0 || readers_in != 0)
+        fail ("%s: writing with %d readers and %d writers inside",
+              thread_name (), readers_in, writers_in - 1);
+      if (i % 7 == 0)
+        timer_sleep (1);
+      else
+        thread_yield ();
+      writes++;
+      writers_in--;
+      rwlock_release_write (&rw);
+      thread_yield ();
+    }
+  if (thread_get_priority () != base)
+    fail ("%s: priority %d after release, expected %d",
+          thread_name (), thread_get_priority (), base);
+  sema_up (&done);
+}
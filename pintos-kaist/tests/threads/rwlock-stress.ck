@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-stress) begin
+(rwlock-stress) 10 threads finished, 100 writes.
+(rwlock-stress) Main should have priority 31.  Actual priority: 31.
+(rwlock-stress) end
+EOF
+pass;
@@ -25,10 +25,24 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-deep", test_priority_donate_deep},
+    {"priority-donate-rwlock", test_priority_donate_rwlock},
+    {"priority-donate-rwlock-chain", test_priority_donate_rwlock_chain},
+    {"rwlock-stress", test_rwlock_stress},
+    {"deadline-admit", test_deadline_admit},
+    {"deadline-wake", test_deadline_wake},
+    {"condvar-broadcast-batch", test_condvar_broadcast_batch},
+    {"workqueue", test_workqueue},
+    {"palloc-zero", test_palloc_zero},
+    {"palloc-buddy", test_palloc_buddy},
+    {"malloc-magazine", test_malloc_magazine},
+    {"malloc-big", test_malloc_big},
+    {"bitmap-scan", test_bitmap_scan},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-condvar-donate", test_priority_condvar_donate},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
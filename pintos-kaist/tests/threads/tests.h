@@ -19,10 +19,24 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_deep;
+extern test_func test_priority_donate_rwlock;
+extern test_func test_priority_donate_rwlock_chain;
+extern test_func test_rwlock_stress;
+extern test_func test_deadline_admit;
+extern test_func test_deadline_wake;
+extern test_func test_condvar_broadcast_batch;
+extern test_func test_workqueue;
+extern test_func test_palloc_zero;
+extern test_func test_palloc_buddy;
+extern test_func test_malloc_magazine;
+extern test_func test_malloc_big;
+extern test_func test_bitmap_scan;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_condvar_donate;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,60 @@
+/* Submits eight items to a work queue whose single worker has
+   lower priority than the main thread, so nothing runs until the
+   main thread blocks.  Checks that submitting a pending item again
+   is refused, that a pending item can be cancelled, and that the
+   rest run in submission order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define ITEM_CNT 8
+
+static work_func record;
+static struct workqueue wq;
+static struct work works[ITEM_CNT];
+static int ids[ITEM_CNT];
+static int order[ITEM_CNT];
+static int ran;
+static struct semaphore done;
+
+void
+test_workqueue (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  if (!workqueue_create (&wq, "test", PRI_DEFAULT - 1, 1))
+    fail ("cannot create work queue");
+
+  for (i = 0; i < ITEM_CNT; i++) 
+    {
+      ids[i] = i;
+      work_init (&works[i], record, &ids[i]);
+      work_submit (&wq, &works[i]);
+    }
+  msg ("Resubmitting a pending item %s.",
+       work_submit (&wq, &works[0]) ? "succeeded" : "was refused");
+  msg ("Cancelling item 3 %s.",
+       work_cancel (&works[3]) ? "succeeded" : "failed");
+
+  for (i = 0; i < ITEM_CNT - 1; i++)
+    sema_down (&done);
+  for (i = 0; i < ran; i++)
+    msg ("Item %d ran.", order[i]);
+  msg ("Cancelling a finished item %s.",
+       work_cancel (&works[0]) ? "succeeded" : "failed");
+}
+
+static void
+record (void *aux) 
+{
+  order[ran++] = *(int *) aux;
+  sema_up (&done);
+}
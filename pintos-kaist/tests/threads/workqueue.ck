@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Resubmitting a pending item was refused.
+(workqueue) Cancelling item 3 succeeded.
+(workqueue) Item 0 ran.
+(workqueue) Item 1 ran.
+(workqueue) Item 2 ran.
+(workqueue) Item 4 ran.
+(workqueue) Item 5 ran.
+(workqueue) Item 6 ran.
+(workqueue) Item 7 ran.
+(workqueue) Cancelling a finished item failed.
+(workqueue) end
+EOF
+pass;
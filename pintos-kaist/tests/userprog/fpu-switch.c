@@ -0,0 +1,85 @@
+/* Checks that SSE registers are per thread and per process.
+
+   The main thread and a second thread each load their own values
+   into %xmm0 and %xmm7 and hand the CPU back and forth through a
+   futex, so that each switch runs the other thread's SSE code.
+   Afterward each must find its own values.  Then the main thread
+   loads new values and forks: the child must start with them and
+   the parent must still have them after the child has run and
+   changed its own. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* User programs are built with -mno-sse, so the compiler never
+   touches the XMM registers between these statements. */
+static inline void
+set_xmm (uint64_t lo, uint64_t hi)
+{
+  asm volatile ("movq %0, %%xmm0; movq %1, %%xmm7" : : "r" (lo), "r" (hi));
+}
+
+static inline void
+get_xmm (uint64_t *lo, uint64_t *hi)
+{
+  uint64_t a, b;
+
+  asm volatile ("movq %%xmm0, %0; movq %%xmm7, %1" : "=r" (a), "=r" (b));
+  *lo = a;
+  *hi = b;
+}
+
+static struct uthread thread;
+static int turn;
+static bool thread_ok;
+
+static void
+other (void *aux UNUSED)
+{
+  uint64_t lo, hi;
+
+  set_xmm (0x2222222222222222ULL, 0x7777777777777777ULL);
+  __atomic_store_n (&turn, 1, __ATOMIC_RELEASE);
+  futex_wake (&turn, 1);
+  while (__atomic_load_n (&turn, __ATOMIC_ACQUIRE) != 2)
+    futex_wait (&turn, 1);
+  get_xmm (&lo, &hi);
+  thread_ok = lo == 0x2222222222222222ULL && hi == 0x7777777777777777ULL;
+}
+
+void
+test_main (void)
+{
+  uint64_t lo, hi;
+  int pid;
+
+  set_xmm (0x1111111111111111ULL, 0x8888888888888888ULL);
+  if (uthread_create (&thread, other, NULL) != 0)
+    fail ("uthread_create failed");
+  while (__atomic_load_n (&turn, __ATOMIC_ACQUIRE) != 1)
+    futex_wait (&turn, 0);
+  get_xmm (&lo, &hi);
+  CHECK (lo == 0x1111111111111111ULL && hi == 0x8888888888888888ULL,
+         "main thread kept its registers");
+  __atomic_store_n (&turn, 2, __ATOMIC_RELEASE);
+  futex_wake (&turn, 1);
+  uthread_join (&thread);
+  CHECK (thread_ok, "second thread kept its registers");
+
+  set_xmm (0x3333333333333333ULL, 0x6666666666666666ULL);
+  if ((pid = fork ("child")) == 0)
+    {
+      get_xmm (&lo, &hi);
+      if (lo != 0x3333333333333333ULL || hi != 0x6666666666666666ULL)
+        exit (1);
+      set_xmm (0x4444444444444444ULL, 0x5555555555555555ULL);
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "child inherited the registers");
+  get_xmm (&lo, &hi);
+  CHECK (lo == 0x3333333333333333ULL && hi == 0x6666666666666666ULL,
+         "parent kept its registers");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-switch) begin
+(fpu-switch) main thread kept its registers
+(fpu-switch) second thread kept its registers
+child: exit(0)
+(fpu-switch) child inherited the registers
+(fpu-switch) parent kept its registers
+(fpu-switch) end
+fpu-switch: exit(0)
+EOF
+pass;
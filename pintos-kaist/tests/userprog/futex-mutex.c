@@ -0,0 +1,67 @@
+/* Runs several threads that update a shared counter under a
+   futex-based mutex, with a slow read-modify-write to invite
+   preemption inside the critical section.  The threads wait on a
+   condition variable until all of them exist.  No update may be
+   lost. */
+
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITER_CNT 200
+
+static struct uthread threads[THREAD_CNT];
+
+static struct umutex mutex;
+static struct ucond start_cond;
+static int started;
+static volatile int counter;
+
+static void
+worker (void *aux UNUSED)
+{
+  int i;
+
+  umutex_lock (&mutex);
+  while (!started)
+    ucond_wait (&start_cond, &mutex);
+  umutex_unlock (&mutex);
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      volatile int j;
+      int value;
+
+      umutex_lock (&mutex);
+      value = counter;
+      for (j = 0; j < 1000; j++)
+        continue;
+      counter = value + 1;
+      umutex_unlock (&mutex);
+    }
+}
+
+void
+test_main (void)
+{
+  int i;
+
+  umutex_init (&mutex);
+  ucond_init (&start_cond);
+
+  msg ("create threads");
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (uthread_create (&threads[i], worker, NULL) == 0,
+           "create thread %d", i);
+
+  umutex_lock (&mutex);
+  started = 1;
+  ucond_broadcast (&start_cond);
+  umutex_unlock (&mutex);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    uthread_join (&threads[i]);
+  CHECK (counter == THREAD_CNT * ITER_CNT, "counter is %d", counter);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-mutex) begin
+(futex-mutex) create threads
+(futex-mutex) create thread 0
+(futex-mutex) create thread 1
+(futex-mutex) create thread 2
+(futex-mutex) create thread 3
+(futex-mutex) counter is 800
+(futex-mutex) end
+futex-mutex: exit(0)
+EOF
+pass;
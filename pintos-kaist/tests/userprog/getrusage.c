@@ -0,0 +1,20 @@
+/* Checks that getrusage() charges a busy loop to user time and
+   system calls to kernel time. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+  volatile int i;
+
+  CHECK (getrusage (&before) == 0, "getrusage");
+  for (i = 0; i < 1000000; i++)
+    continue;
+  CHECK (getrusage (&after) == 0, "getrusage");
+  CHECK (after.user_cycles > before.user_cycles, "user time advanced");
+  CHECK (after.kernel_cycles > before.kernel_cycles, "kernel time advanced");
+}
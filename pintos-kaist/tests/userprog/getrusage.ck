@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) getrusage
+(getrusage) getrusage
+(getrusage) user time advanced
+(getrusage) kernel time advanced
+(getrusage) end
+getrusage: exit(0)
+EOF
+pass;
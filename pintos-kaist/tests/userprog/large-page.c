@@ -0,0 +1,51 @@
+/* Run with -lp, so that the kernel maps the aligned 2 MB parts of
+   this 5 MB zero-initialized array with large pages.  Checks that
+   the array starts out zeroed and keeps what is written to it,
+   and that a forked child gets its own copy. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (5 * 1024 * 1024)
+
+static char buf[SIZE];
+
+static void
+check (char value) 
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != value)
+      fail ("byte %zu is %d, not %d", i, buf[i], value);
+}
+
+void
+test_main (void) 
+{
+  int pid;
+
+  check (0);
+  msg ("zeroed");
+
+  memset (buf, 0x5a, sizeof buf);
+  check (0x5a);
+  msg ("filled");
+
+  if ((pid = fork ("child"))) 
+    {
+      int status = wait (pid);
+      msg ("Parent: child exit status is %d", status);
+      check (0x5a);
+      msg ("parent copy unchanged");
+    }
+  else 
+    {
+      check (0x5a);
+      memset (buf, 0x33, sizeof buf);
+      check (0x33);
+      exit (81);
+    }
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(large-page) begin
+(large-page) zeroed
+(large-page) filled
+child: exit(81)
+(large-page) Parent: child exit status is 81
+(large-page) parent copy unchanged
+(large-page) end
+large-page: exit(0)
+EOF
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my ($mapped) = map (/^Paging: (\d+) user large pages mapped$/, @output);
+fail "missing large page statistics in output\n" if !defined $mapped;
+fail "no user large page was mapped\n" if $mapped == 0;
+pass;
@@ -0,0 +1,62 @@
+/* Forks a child that starts two threads, one blocked in wait() on
+   a grandchild that never exits and one blocked reading the
+   console, and then calls exit().  Both sleeps must be cut short
+   so that the parent's wait() returns the child's status. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 2
+
+static struct uthread threads[THREAD_CNT];
+static int ready;
+static int never;
+static int grandchild;
+
+static void
+waiter (void *aux UNUSED)
+{
+  __atomic_add_fetch (&ready, 1, __ATOMIC_RELEASE);
+  wait (grandchild);
+  fail ("waiter returned from wait");
+}
+
+static void
+reader (void *aux UNUSED)
+{
+  char c;
+
+  __atomic_add_fetch (&ready, 1, __ATOMIC_RELEASE);
+  read (STDIN_FILENO, &c, 1);
+  fail ("reader returned from read");
+}
+
+void
+test_main (void)
+{
+  int pid;
+  int i;
+
+  if ((pid = fork ("child")))
+    {
+      CHECK (wait (pid) == 58, "wait for child");
+      return;
+    }
+
+  if ((grandchild = fork ("grandchild")) == 0)
+    {
+      futex_wait (&never, 0);
+      fail ("grandchild returned from futex_wait");
+    }
+
+  msg ("create threads");
+  for (i = 0; i < THREAD_CNT; i++)
+    if (uthread_create (&threads[i], i == 0 ? waiter : reader, NULL) != 0)
+      fail ("uthread_create failed");
+  while (__atomic_load_n (&ready, __ATOMIC_ACQUIRE) < THREAD_CNT)
+    continue;
+  exit (58);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-group-exit-sleep) begin
+(thread-group-exit-sleep) create threads
+child: exit(58)
+(thread-group-exit-sleep) wait for child
+(thread-group-exit-sleep) end
+thread-group-exit-sleep: exit(0)
+EOF
+pass;
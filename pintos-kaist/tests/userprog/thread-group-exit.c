@@ -0,0 +1,65 @@
+/* Forks a child that starts threads on kernel-allocated stacks,
+   two spinning in user mode and one asleep on a futex, and then
+   calls exit().  The exit must take all of the threads down with
+   it before the parent's wait() returns the child's status. */
+
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 3
+
+static struct uthread threads[THREAD_CNT];
+static void *stack_addrs[THREAD_CNT];
+static int ready;
+static int never;
+
+static void
+spinner (void *aux)
+{
+  int local;
+
+  *(void **) aux = &local;
+  __atomic_add_fetch (&ready, 1, __ATOMIC_RELEASE);
+  for (;;)
+    continue;
+}
+
+static void
+sleeper (void *aux)
+{
+  int local;
+
+  *(void **) aux = &local;
+  __atomic_add_fetch (&ready, 1, __ATOMIC_RELEASE);
+  futex_wait (&never, 0);
+  fail ("sleeper returned from futex_wait");
+}
+
+void
+test_main (void)
+{
+  int pid;
+  int i;
+
+  if ((pid = fork ("child")))
+    {
+      CHECK (wait (pid) == 57, "wait for child");
+      return;
+    }
+
+  msg ("create threads");
+  for (i = 0; i < THREAD_CNT; i++)
+    if (uthread_create (&threads[i], i == 0 ? sleeper : spinner,
+                        &stack_addrs[i]) != 0)
+      fail ("uthread_create failed");
+  while (__atomic_load_n (&ready, __ATOMIC_ACQUIRE) < THREAD_CNT)
+    continue;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (stack_addrs[i] == stack_addrs[(i + 1) % THREAD_CNT])
+      fail ("threads %d and %d share a stack", i, (i + 1) % THREAD_CNT);
+  msg ("stacks are distinct");
+  exit (57);
+}
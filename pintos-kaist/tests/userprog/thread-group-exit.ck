@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-group-exit) begin
+(thread-group-exit) create threads
+(thread-group-exit) stacks are distinct
+child: exit(57)
+(thread-group-exit) wait for child
+(thread-group-exit) end
+thread-group-exit: exit(0)
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Calls thread_create() directly with a null stack, so that the
+   kernel allocates one, and checks that the thread runs on it and
+   that thread_exit() clears and wakes the join word. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int running = 1;
+static int value;
+static void *stack_addr;
+
+static void
+worker (void *aux)
+{
+  int local;
+
+  stack_addr = &local;
+  value = (int) (long) aux;
+  thread_exit (&running);
+}
+
+void
+test_main (void)
+{
+  int main_local;
+  int tid = thread_create (worker, (void *) 42L, NULL);
+  int r;
+
+  CHECK (tid >= 0, "thread_create with a null stack");
+  while ((r = __atomic_load_n (&running, __ATOMIC_ACQUIRE)) != 0)
+    futex_wait (&running, r);
+  CHECK (value == 42, "thread ran");
+  CHECK (stack_addr != NULL && (char *) stack_addr < (char *) &main_local,
+         "thread stack is below the main stack");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-kstack) begin
+(thread-kstack) thread_create with a null stack
+(thread-kstack) thread ran
+(thread-kstack) thread stack is below the main stack
+(thread-kstack) end
+thread-kstack: exit(0)
+EOF
+pass;
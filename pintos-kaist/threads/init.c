@@ -20,7 +20,10 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/workqueue.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -80,6 +83,7 @@ main (void) {
 	/* Initialize ourselves as a thread so we can use locks,
 	   then enable console locking. */
 	thread_init ();
+	trace_init ();
 	console_init ();
 
 	/* Initialize memory system. */
@@ -90,6 +94,7 @@ main (void) {
 #ifdef USERPROG
 	tss_init ();
 	gdt_init ();
+	process_cache_init ();
 #endif
 
 	/* Initialize interrupt handlers. */
@@ -103,6 +108,8 @@ main (void) {
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	workqueue_init ();
+	palloc_start_zeroing ();
 	serial_init_queue ();
 	timer_calibrate ();
 
@@ -143,7 +150,9 @@ bss_init (void) {
 
 /* 커널 가상 매핑으로 페이지 테이블을 채운 후,
 CPU가 새 페이지 디렉터리를 사용하도록 설정합니다.
-생성한 pml4를 base_pml4에 지정합니다. */
+생성한 pml4를 base_pml4에 지정합니다.
+2 MB 단위로 정렬된 구간은 큰 페이지(PDE) 하나로 매핑하여
+페이지 테이블 메모리와 TLB 엔트리를 아낍니다. */
 static void
 paging_init (uint64_t mem_end) {
 	uint64_t *pml4, *pte;
@@ -156,6 +165,17 @@ paging_init (uint64_t mem_end) {
 	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
 		uint64_t va = (uint64_t) ptov(pa);
 
+		/* 커널 텍스트는 읽기 전용이어야 하므로, 텍스트와 겹치지 않는
+		   2 MB 구간만 큰 페이지로 매핑합니다. */
+		if ((pa & LPGMASK) == 0 && pa + LPGSIZE <= mem_end
+				&& (va + LPGSIZE <= (uint64_t) &start
+					|| va >= (uint64_t) &_end_kernel_text)) {
+			if ((pte = pde_walk (pml4, va, 1)) != NULL)
+				*pte = pa | PTE_PS | PTE_P | PTE_W;
+			pa += LPGSIZE - PGSIZE;
+			continue;
+		}
+
 		perm = PTE_P | PTE_W;
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
@@ -222,9 +242,17 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-trace")) {
+			trace_enabled = true;
+			trace_file = value;
+		}
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
+		else if (!strcmp (name, "-lp"))
+			user_large_pages = true;
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
 #endif
@@ -325,8 +353,11 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -trace[=FILE]      Trace scheduling, dump at power off (to FILE).\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -lp                Map large anonymous user regions with 2 MB pages.\n"
 #endif
 			);
 	power_off ();
@@ -337,6 +368,7 @@ usage (void) {
    as long as we're running on Bochs or QEMU. */
 void
 power_off (void) {
+	trace_dump ();
 #ifdef FILESYS
 	filesys_done ();
 #endif
@@ -353,6 +385,14 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	malloc_print_stats ();
+#ifdef USERPROG
+	pml4_print_stats ();
+#endif
+	slab_print_stats ();
+	workqueue_print_stats ();
+	lock_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -13,6 +13,7 @@
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -372,6 +373,13 @@ intr_handler (struct intr_frame *frame) {
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+#ifdef USERPROG
+	/* A thread about to return to user mode in a process that is
+	   exiting as a group terminates here instead. */
+	if ((frame->cs & 3) == 3)
+		process_check_exit ();
+#endif
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
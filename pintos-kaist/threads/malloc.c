@@ -1,12 +1,15 @@
 #include "threads/malloc.h"
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <round.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -32,14 +35,58 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.  Each run
+   length up to BIG_CLASSES pages is a size class of its own, with
+   a cache of recently freed runs, so that a workload that keeps
+   allocating and freeing buffers of a few pages does not go back
+   to the page allocator every time.  The cache holds at most
+   BIG_CACHE_PAGES pages, and is emptied if the page allocator runs
+   out.  realloc() of a big block shrinks it in place, and grows it
+   in place if the pages after it are free.
+
+   In front of each descriptor's free list, every CPU has a small
+   "magazine" of free blocks.  malloc() pops from it and free()
+   pushes onto it with interrupts briefly disabled, taking no lock.
+   Only when the magazine is empty does malloc() take the
+   descriptor's lock, to move a batch of blocks into it; only when
+   it is full does free() move the older half back.  Blocks in a
+   magazine count as in use as far as their arena is concerned, so
+   an arena is not freed while a magazine holds one of its blocks. */
+
+/* Magazine sizes. */
+#define MAG_ROUNDS 16               /* Blocks a magazine can hold. */
+#define MAG_BATCH 8                 /* Blocks moved per refill or flush. */
+
+/* Per-CPU cache of free blocks of one descriptor. */
+struct magazine {
+	size_t avail;               /* Blocks in OBJS. */
+	void *objs[MAG_ROUNDS];     /* Free blocks, most recently freed last. */
+	unsigned long long hits;    /* Requests served from OBJS. */
+	unsigned long long misses;  /* Allocations that found OBJS empty. */
+	unsigned long long flushes; /* Frees that found OBJS full. */
+};
+
+/* Big block run cache sizes. */
+#define BIG_CLASSES 17              /* Longest cached run, in pages. */
+#define BIG_CACHE_PAGES 256         /* Most pages kept in the cache. */
+
+/* Cached runs of one length. */
+struct big_class {
+	struct list runs;           /* Freed runs, most recently freed first. */
+	unsigned long long hits;    /* Allocations served from RUNS. */
+	unsigned long long misses;  /* Allocations that found RUNS empty. */
+};
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	struct magazine mags[NCPU]; /* Per-CPU magazines. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+	char name[16];              /* Lock name, for statistics. */
+	unsigned long long arenas_created; /* Arenas obtained from palloc. */
+	unsigned long long arenas_freed;   /* Arenas given back to palloc. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -57,35 +104,85 @@ struct block {
 	struct list_elem free_elem; /* Free list element. */
 };
 
+/* Cached run of pages, in place of its arena header. */
+struct big_run {
+	struct list_elem elem;      /* Element in big_class's RUNS. */
+	size_t page_cnt;            /* Pages in run. */
+};
+
 /* Our set of descriptors. */
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Big block run cache. */
+static struct big_class big_classes[BIG_CLASSES + 1]; /* Indexed by pages. */
+static struct spinlock big_lock;    /* Protects the run cache. */
+static size_t big_cached;           /* Pages in the run cache. */
+static unsigned long long big_grown; /* Big blocks grown in place. */
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void *refill_magazine (struct desc *);
+static void return_blocks (struct desc *, void **blocks, size_t cnt);
+static struct arena *big_alloc (size_t page_cnt);
+static void big_free (struct arena *);
+static void *block_alloc (size_t);
+static void *block_realloc (void *, size_t);
+static void block_free (void *);
+#ifdef MALLOC_PROFILE
+static void prof_init (void);
+static void *prof_alloc (size_t) NO_INLINE;
+static void *prof_realloc (void *, size_t) NO_INLINE;
+static void prof_free (void *);
+static void prof_print_report (void);
+#endif
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
 	size_t block_size;
+	size_t i;
 
 	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
 		struct desc *d = &descs[desc_cnt++];
 		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+		memset (d->mags, 0, sizeof d->mags);
 		list_init (&d->free_list);
-		lock_init (&d->lock);
+		snprintf (d->name, sizeof d->name, "malloc%zu", block_size);
+		lock_init_adaptive (&d->lock, d->name);
+		d->arenas_created = d->arenas_freed = 0;
 	}
+
+	for (i = 0; i <= BIG_CLASSES; i++) {
+		list_init (&big_classes[i].runs);
+		big_classes[i].hits = big_classes[i].misses = 0;
+	}
+	spin_init (&big_lock);
+#ifdef MALLOC_PROFILE
+	prof_init ();
+#endif
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+#ifdef MALLOC_PROFILE
+	return prof_alloc (size);
+#else
+	return block_alloc (size);
+#endif
+}
+
+/* Implements malloc(). */
+static void *
+block_alloc (size_t size) {
 	struct desc *d;
-	struct block *b;
+	struct magazine *m;
 	struct arena *a;
+	enum intr_level old_level;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -100,7 +197,7 @@ malloc (size_t size) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
-		a = palloc_get_multiple (0, page_cnt);
+		a = big_alloc (page_cnt);
 		if (a == NULL)
 			return NULL;
 
@@ -112,35 +209,77 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
+	/* Try this CPU's magazine. */
+	old_level = intr_disable ();
+	m = &d->mags[thread_cpu_id ()];
+	if (m->avail > 0) {
+		void *b = m->objs[--m->avail];
+		m->hits++;
+		intr_set_level (old_level);
+		return b;
+	}
+	m->misses++;
+	intr_set_level (old_level);
 
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
+	return refill_magazine (d);
+}
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
-		}
+/* Takes a batch of blocks from D's free list, creating an arena if
+   it is empty.  Returns one block and puts the rest in the current
+   CPU's magazine.  Returns a null pointer if memory is not
+   available. */
+static void *
+refill_magazine (struct desc *d) {
+	void *batch[MAG_BATCH];
+	struct magazine *m;
+	enum intr_level old_level;
+	size_t cnt = 0;
 
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
+	lock_acquire (&d->lock);
+	while (cnt < MAG_BATCH) {
+		struct block *b;
+
+		/* If the free list is empty, create a new arena. */
+		if (list_empty (&d->free_list)) {
+			struct arena *a;
+			size_t i;
+
+			/* Allocate a page. */
+			a = palloc_get_page (0);
+			if (a == NULL)
+				break;
+			d->arenas_created++;
+
+			/* Initialize arena and add its blocks to the free list. */
+			a->magic = ARENA_MAGIC;
+			a->desc = d;
+			a->free_cnt = d->blocks_per_arena;
+			for (i = 0; i < d->blocks_per_arena; i++) {
+				struct block *b = arena_to_block (a, i);
+				list_push_back (&d->free_list, &b->free_elem);
+			}
 		}
-	}
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
+		/* Get a block from free list. */
+		b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+		block_to_arena (b)->free_cnt--;
+		batch[cnt++] = b;
+	}
 	lock_release (&d->lock);
-	return b;
+	if (cnt == 0)
+		return NULL;
+
+	/* Keep BATCH[0] for the caller.  Another thread may have filled
+	   the magazine while we waited for the lock; anything that does
+	   not fit goes back. */
+	old_level = intr_disable ();
+	m = &d->mags[thread_cpu_id ()];
+	while (cnt > 1 && m->avail < MAG_ROUNDS)
+		m->objs[m->avail++] = batch[--cnt];
+	intr_set_level (old_level);
+	if (cnt > 1)
+		return_blocks (d, batch + 1, cnt - 1);
+	return batch[0];
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -156,7 +295,11 @@ calloc (size_t a, size_t b) {
 		return NULL;
 
 	/* Allocate and zero memory. */
+#ifdef MALLOC_PROFILE
+	p = prof_alloc (size);
+#else
 	p = malloc (size);
+#endif
 	if (p != NULL)
 		memset (p, 0, size);
 
@@ -181,16 +324,49 @@ block_size (void *block) {
    A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
 void *
 realloc (void *old_block, size_t new_size) {
+#ifdef MALLOC_PROFILE
+	return prof_realloc (old_block, new_size);
+#else
+	return block_realloc (old_block, new_size);
+#endif
+}
+
+/* Implements realloc(). */
+static void *
+block_realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
-		free (old_block);
+		block_free (old_block);
 		return NULL;
 	} else {
-		void *new_block = malloc (new_size);
+		void *new_block;
+
+		if (old_block != NULL && block_to_arena (old_block)->desc == NULL
+				&& new_size > descs[desc_cnt - 1].block_size) {
+			/* A big block that stays big.  Try to resize it in place. */
+			struct arena *a = block_to_arena (old_block);
+			size_t page_cnt = DIV_ROUND_UP (pg_ofs (old_block) + new_size, PGSIZE);
+
+			if (page_cnt <= a->free_cnt) {
+				palloc_free_multiple ((uint8_t *) a + PGSIZE * page_cnt,
+						a->free_cnt - page_cnt);
+				a->free_cnt = page_cnt;
+				return old_block;
+			}
+			if (palloc_extend (a, a->free_cnt, page_cnt)) {
+				a->free_cnt = page_cnt;
+				spin_lock (&big_lock);
+				big_grown++;
+				spin_unlock (&big_lock);
+				return old_block;
+			}
+		}
+
+		new_block = block_alloc (new_size);
 		if (old_block != NULL && new_block != NULL) {
 			size_t old_size = block_size (old_block);
 			size_t min_size = new_size < old_size ? new_size : old_size;
 			memcpy (new_block, old_block, min_size);
-			free (old_block);
+			block_free (old_block);
 		}
 		return new_block;
 	}
@@ -200,6 +376,16 @@ realloc (void *old_block, size_t new_size) {
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) {
+#ifdef MALLOC_PROFILE
+	prof_free (p);
+#else
+	block_free (p);
+#endif
+}
+
+/* Implements free(). */
+static void
+block_free (void *p) {
 	if (p != NULL) {
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
@@ -207,38 +393,455 @@ free (void *p) {
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			void *batch[MAG_BATCH];
+			struct magazine *m;
+			enum intr_level old_level;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
+			/* Put it in this CPU's magazine.  If that is full, move
+			   out the older half, which is least likely to be warm
+			   in the cache, and return it to the free list. */
+			old_level = intr_disable ();
+			m = &d->mags[thread_cpu_id ()];
+			if (m->avail < MAG_ROUNDS) {
+				m->objs[m->avail++] = b;
+				m->hits++;
+				intr_set_level (old_level);
+				return;
+			}
+			m->flushes++;
+			memcpy (batch, m->objs, sizeof batch);
+			memmove (m->objs, m->objs + MAG_BATCH,
+					(MAG_ROUNDS - MAG_BATCH) * sizeof *m->objs);
+			m->avail -= MAG_BATCH;
+			m->objs[m->avail++] = b;
+			intr_set_level (old_level);
+
+			return_blocks (d, batch, MAG_BATCH);
+		} else {
+			/* It's a big block.  Cache or free its pages. */
+			big_free (a);
+			return;
+		}
+	}
+}
+
+#ifdef MALLOC_PROFILE
+/* Allocation profiling, enabled by building with MALLOC_PROFILE
+   defined ("make MALLOC_PROFILE=1").
+
+   Every block then starts with a header that names the site that
+   allocated it and the size requested, so a request is 16 bytes
+   larger than it looks and a 1 kB request becomes a big block.
+   A site is the return address of a call to malloc(), calloc(),
+   or realloc().  Each site counts its live bytes and their
+   high-water mark, and keeps the call stack of its first
+   allocation, in the form debug_backtrace() prints, so that the
+   "backtrace" program can translate it.  malloc_print_stats()
+   lists the sites with the most live bytes.
+
+   free() and realloc() check the header's magic number, which is
+   cleared on free, so a double free or an overrun into the next
+   block's header panics there rather than corrupting a free list. */
+
+#define PROF_MAGIC 0x70f11e5a
+#define PROF_SITES 256              /* Sites tracked individually. */
+#define PROF_DEPTH 6                /* Call stack entries kept per site. */
+#define PROF_REPORT 20              /* Sites printed. */
+
+/* Allocation site. */
+struct prof_site {
+	void *pc;                   /* Return address of the call, or null. */
+	void *stack[PROF_DEPTH];    /* Call stack of first allocation. */
+	size_t live_bytes;          /* Bytes allocated and not yet freed. */
+	size_t live_blocks;         /* Blocks allocated and not yet freed. */
+	size_t peak_bytes;          /* High-water mark of LIVE_BYTES. */
+	unsigned long long allocs;  /* Total allocations. */
+};
+
+/* Header in front of each block. */
+struct prof_hdr {
+	struct prof_site *site;     /* Allocation site. */
+	uint32_t size;              /* Bytes requested. */
+	uint32_t magic;             /* PROF_MAGIC while allocated. */
+};
+
+static struct prof_site prof_sites[PROF_SITES]; /* Hash table by PC. */
+static struct prof_site prof_other; /* Sites that did not fit. */
+static struct spinlock prof_lock;   /* Protects the members above and below. */
+static size_t prof_live;            /* Live bytes in all sites. */
+static size_t prof_peak;            /* High-water mark of PROF_LIVE. */
+static unsigned long long prof_failed; /* Allocations that failed. */
+
+/* Number of call stack entries above the site: prof_alloc() or
+   prof_realloc(), and its caller malloc(), calloc(), or realloc(). */
+#define PROF_SKIP 2
+
+static void
+prof_init (void) {
+	spin_init (&prof_lock);
+}
+
+/* Returns the site for the call stack STACK, as stored by
+   debug_backtrace_save() in prof_alloc() or prof_realloc().
+   prof_lock must be held. */
+static struct prof_site *
+prof_find_site (void **stack) {
+	void *pc = stack[PROF_SKIP];
+	size_t i = hash_bytes (&pc, sizeof pc) % PROF_SITES;
+	size_t n;
+
+	for (n = 0; n < PROF_SITES; n++, i = (i + 1) % PROF_SITES) {
+		struct prof_site *s = &prof_sites[i];
+
+		if (s->pc == pc)
+			return s;
+		if (s->pc == NULL) {
+			s->pc = pc;
+			memcpy (s->stack, stack + PROF_SKIP, sizeof s->stack);
+			return s;
+		}
+	}
+	return &prof_other;
+}
+
+/* Stamps header H for a block of SIZE bytes allocated with call
+   stack STACK, and accounts for it.  prof_lock must be held. */
+static void
+prof_add (struct prof_hdr *h, size_t size, void **stack) {
+	struct prof_site *s = prof_find_site (stack);
+
+	h->site = s;
+	h->size = size;
+	h->magic = PROF_MAGIC;
+	s->allocs++;
+	s->live_blocks++;
+	s->live_bytes += size;
+	if (s->live_bytes > s->peak_bytes)
+		s->peak_bytes = s->live_bytes;
+	prof_live += size;
+	if (prof_live > prof_peak)
+		prof_peak = prof_live;
+}
+
+/* Removes the block with header H from its site's counts.
+   prof_lock must be held. */
+static void
+prof_remove (struct prof_hdr *h) {
+	h->site->live_blocks--;
+	h->site->live_bytes -= h->size;
+	prof_live -= h->size;
+	h->magic = 0;
+}
+
+/* Returns the header of block P, panicking if it is not intact. */
+static struct prof_hdr *
+prof_hdr (void *p) {
+	struct prof_hdr *h = (struct prof_hdr *) p - 1;
+
+	if (h->magic != PROF_MAGIC)
+		PANIC ("malloc: block %p was freed or its header was overwritten", p);
+	return h;
+}
+
+/* Allocates a block of SIZE bytes for call stack STACK. */
+static void *
+prof_alloc_at (size_t size, void **stack) {
+	struct prof_hdr *h = NULL;
+
+	if (size <= UINT32_MAX - sizeof *h)
+		h = block_alloc (sizeof *h + size);
+
+	spin_lock (&prof_lock);
+	if (h != NULL)
+		prof_add (h, size, stack);
+	else
+		prof_failed++;
+	spin_unlock (&prof_lock);
+	return h != NULL ? h + 1 : NULL;
+}
+
+/* Implements malloc() when profiling. */
+static void *
+prof_alloc (size_t size) {
+	void *stack[PROF_SKIP + PROF_DEPTH];
+
+	if (size == 0)
+		return NULL;
+
+	memset (stack, 0, sizeof stack);
+	debug_backtrace_save (stack, PROF_SKIP + PROF_DEPTH);
+	return prof_alloc_at (size, stack);
+}
+
+/* Implements realloc() when profiling.  The block is charged to
+   the site that resized it. */
+static void *
+prof_realloc (void *old_block, size_t new_size) {
+	void *stack[PROF_SKIP + PROF_DEPTH];
+	struct prof_hdr *old_h, *h = NULL;
+	struct prof_hdr saved;
+
+	if (new_size == 0) {
+		prof_free (old_block);
+		return NULL;
+	}
+
+	memset (stack, 0, sizeof stack);
+	debug_backtrace_save (stack, PROF_SKIP + PROF_DEPTH);
+	if (old_block == NULL)
+		return prof_alloc_at (new_size, stack);
+	old_h = prof_hdr (old_block);
+
+	/* Uncharge the old block first, because block_realloc() may
+	   free it.  Put it back if the resize fails. */
+	spin_lock (&prof_lock);
+	saved = *old_h;
+	prof_remove (old_h);
+	spin_unlock (&prof_lock);
+
+	if (new_size <= UINT32_MAX - sizeof *h)
+		h = block_realloc (old_h, sizeof *h + new_size);
+
+	spin_lock (&prof_lock);
+	if (h != NULL)
+		prof_add (h, new_size, stack);
+	else {
+		*old_h = saved;
+		saved.site->live_blocks++;
+		saved.site->live_bytes += saved.size;
+		prof_live += saved.size;
+		prof_failed++;
+	}
+	spin_unlock (&prof_lock);
+	return h != NULL ? h + 1 : NULL;
+}
+
+/* Implements free() when profiling. */
+static void
+prof_free (void *p) {
+	struct prof_hdr *h;
+
+	if (p == NULL)
+		return;
+
+	h = prof_hdr (p);
+	spin_lock (&prof_lock);
+	prof_remove (h);
+	spin_unlock (&prof_lock);
+	block_free (h);
+}
+
+/* Prints the sites with the most live bytes, most first. */
+static void
+prof_print_report (void) {
+	static struct prof_site *sorted[PROF_SITES + 1];
+	size_t cnt = 0;
+	size_t i, j;
+
+	for (i = 0; i < PROF_SITES; i++)
+		if (prof_sites[i].pc != NULL)
+			sorted[cnt++] = &prof_sites[i];
+	if (prof_other.allocs != 0)
+		sorted[cnt++] = &prof_other;
+
+	/* Insertion sort by live bytes, then by peak. */
+	for (i = 1; i < cnt; i++) {
+		struct prof_site *s = sorted[i];
+
+		for (j = i; j > 0; j--) {
+			struct prof_site *t = sorted[j - 1];
+
+			if (t->live_bytes > s->live_bytes
+					|| (t->live_bytes == s->live_bytes
+						&& t->peak_bytes >= s->peak_bytes))
+				break;
+			sorted[j] = t;
+		}
+		sorted[j] = s;
+	}
+
+	printf ("Malloc profile: %zu bytes live, %zu peak, %zu sites, "
+			"%llu failed allocations\n",
+			prof_live, prof_peak, cnt, prof_failed);
+	for (i = 0; i < cnt && i < PROF_REPORT; i++) {
+		struct prof_site *s = sorted[i];
+
+		if (s == &prof_other)
+			printf ("Malloc other sites:");
+		else
+			printf ("Malloc site %p:", s->pc);
+		printf (" %zu bytes live in %zu blocks, peak %zu, %llu allocations.\n",
+				s->live_bytes, s->live_blocks, s->peak_bytes, s->allocs);
+		if (s != &prof_other) {
+			printf ("Call stack:");
+			for (j = 0; j < PROF_DEPTH && s->stack[j] != NULL; j++)
+				printf (" %p", s->stack[j]);
+			printf (".\n");
+		}
+	}
+}
+#endif /* MALLOC_PROFILE */
+
+/* Returns the CNT blocks in BLOCKS to D's free list, freeing any
+   arena that becomes entirely unused. */
+static void
+return_blocks (struct desc *d, void **blocks, size_t cnt) {
+	size_t i;
 
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
+	lock_acquire (&d->lock);
+	for (i = 0; i < cnt; i++) {
+		struct block *b = blocks[i];
+		struct arena *a = block_to_arena (b);
 
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
+		/* Add block to free list. */
+		list_push_front (&d->free_list, &b->free_elem);
 
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+		/* If the arena is now entirely unused, free it. */
+		if (++a->free_cnt >= d->blocks_per_arena) {
+			size_t j;
+
+			ASSERT (a->free_cnt == d->blocks_per_arena);
+			for (j = 0; j < d->blocks_per_arena; j++) {
+				struct block *b = arena_to_block (a, j);
+				list_remove (&b->free_elem);
 			}
+			palloc_free_page (a);
+			d->arenas_freed++;
+		}
+	}
+	lock_release (&d->lock);
+}
 
-			lock_release (&d->lock);
-		} else {
-			/* It's a big block.  Free its pages. */
-			palloc_free_multiple (a, a->free_cnt);
+/* Returns every run in the big block cache to the page
+   allocator.  Returns true if there were any. */
+static bool
+big_flush (void) {
+	struct list runs;
+	size_t i;
+
+	list_init (&runs);
+	spin_lock (&big_lock);
+	for (i = 1; i <= BIG_CLASSES; i++)
+		while (!list_empty (&big_classes[i].runs))
+			list_push_back (&runs, list_pop_front (&big_classes[i].runs));
+	big_cached = 0;
+	spin_unlock (&big_lock);
+
+	if (list_empty (&runs))
+		return false;
+	while (!list_empty (&runs)) {
+		struct big_run *r = list_entry (list_pop_front (&runs),
+				struct big_run, elem);
+		palloc_free_multiple (r, r->page_cnt);
+	}
+	return true;
+}
+
+/* Obtains a run of PAGE_CNT pages for a big block, from the run
+   cache if possible.  Returns a null pointer if memory is not
+   available. */
+static struct arena *
+big_alloc (size_t page_cnt) {
+	struct arena *a;
+
+	if (page_cnt <= BIG_CLASSES) {
+		struct big_class *c = &big_classes[page_cnt];
+		struct big_run *r = NULL;
+
+		spin_lock (&big_lock);
+		if (!list_empty (&c->runs)) {
+			r = list_entry (list_pop_front (&c->runs), struct big_run, elem);
+			big_cached -= page_cnt;
+			c->hits++;
+		} else
+			c->misses++;
+		spin_unlock (&big_lock);
+		if (r != NULL)
+			return (struct arena *) r;
+	}
+
+	/* Call the page allocator without the spinlock held: it takes
+	   its pool's own lock and may work_submit() a refill of the
+	   zeroed-page stash, and neither should nest inside this lock.
+	   If it is out of memory, try again after giving it back the
+	   cached runs. */
+	a = palloc_get_multiple (0, page_cnt);
+	if (a == NULL && big_flush ())
+		a = palloc_get_multiple (0, page_cnt);
+	return a;
+}
+
+/* Frees big block arena A, keeping its pages in the run cache if
+   there is room. */
+static void
+big_free (struct arena *a) {
+	size_t page_cnt = a->free_cnt;
+
+	if (page_cnt <= BIG_CLASSES) {
+		struct big_run *r = (struct big_run *) a;
+		bool cached = false;
+
+#ifndef NDEBUG
+		/* Clear the block to help detect use-after-free bugs. */
+		memset (a, 0xcc, PGSIZE * page_cnt);
+#endif
+		r->page_cnt = page_cnt;
+		spin_lock (&big_lock);
+		if (big_cached + page_cnt <= BIG_CACHE_PAGES) {
+			list_push_front (&big_classes[page_cnt].runs, &r->elem);
+			big_cached += page_cnt;
+			cached = true;
+		}
+		spin_unlock (&big_lock);
+		if (cached)
 			return;
+	}
+	palloc_free_multiple (a, page_cnt);
+}
+
+/* Prints statistics for each descriptor. */
+void
+malloc_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < desc_cnt; i++) {
+		struct desc *d = &descs[i];
+		unsigned long long hits = 0, misses = 0, flushes = 0;
+		int c;
+
+		for (c = 0; c < NCPU; c++) {
+			hits += d->mags[c].hits;
+			misses += d->mags[c].misses;
+			flushes += d->mags[c].flushes;
 		}
+		if (hits + misses + flushes == 0)
+			continue;
+		printf ("Malloc %zu: %llu magazine hits, %llu misses, %llu flushes, "
+				"%llu arenas created, %llu freed\n",
+				d->block_size, hits, misses, flushes,
+				d->arenas_created, d->arenas_freed);
+	}
+
+	for (i = 1; i <= BIG_CLASSES; i++) {
+		struct big_class *c = &big_classes[i];
+
+		if (c->hits + c->misses == 0)
+			continue;
+		printf ("Malloc %zu pages: %llu run cache hits, %llu misses\n",
+				i, c->hits, c->misses);
 	}
+	printf ("Malloc big blocks: %zu pages cached, %llu grown in place\n",
+			big_cached, big_grown);
+#ifdef MALLOC_PROFILE
+	prof_print_report ();
+#endif
 }
-
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -1,5 +1,6 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
 #include "threads/pte.h"
@@ -8,11 +9,26 @@
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* If true, the loader maps the anonymous parts of user memory that
+ * cover whole, aligned large pages with large pages.  Set by the
+ * "-lp" kernel command-line option. */
+bool user_large_pages;
+
+/* User large pages mapped so far. */
+static unsigned long long large_page_cnt;
+
+/* A page directory entry with PTE_PS set maps a large page itself,
+ * and then serves as the "page table entry" for every address in
+ * it: walking to such an address returns the page directory entry,
+ * and pml4_for_each() passes it to its function once, with the
+ * large page's address. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if ((uint64_t) pte & PTE_P && (uint64_t) pte & PTE_PS)
+			return create ? NULL : &pdp[idx];
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -88,6 +104,38 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the table that the present entry *ENTRY points to.  If
+ * *ENTRY is not present and CREATE is true, points it to a new,
+ * empty table first.  Returns a null pointer if *ENTRY is not
+ * present and CREATE is false, or if memory allocation fails. */
+static uint64_t *
+next_table (uint64_t *entry, int create) {
+	if (!(*entry & PTE_P)) {
+		uint64_t *new_page;
+
+		if (!create || (new_page = palloc_get_page (PAL_ZERO)) == NULL)
+			return NULL;
+		*entry = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	return ptov (PTE_ADDR (*entry));
+}
+
+/* Returns the address of the page directory entry for virtual
+ * address VA in PML4, for mapping a large page.  If the page
+ * directory is missing, behavior depends on CREATE as for
+ * pml4e_walk().  Tables created on the way are left in place if
+ * a later allocation fails; pml4_destroy() frees them. */
+uint64_t *
+pde_walk (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *pdpe, *pde;
+
+	if ((pdpe = next_table (&pml4[PML4 (va)], create)) == NULL)
+		return NULL;
+	if ((pde = next_table (&pdpe[PDPE (va)], create)) == NULL)
+		return NULL;
+	return &pde[PDX (va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -122,7 +170,13 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_P && pdp[i] & PTE_PS) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -169,7 +223,9 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_P && pdp[i] & PTE_PS)
+			palloc_free_multiple ((void *) PTE_ADDR (pte), LPGSIZE / PGSIZE);
+		else if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -217,7 +273,8 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
 	if (pte && (*pte & PTE_P))
-		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+		return ptov (PTE_ADDR (*pte))
+			+ ((uint64_t) uaddr & (is_large_pte (pte) ? LPGMASK : PGMASK));
 	return NULL;
 }
 
@@ -243,6 +300,29 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Adds a mapping in PML4 from the user virtual large page UPAGE
+ * to the large page at kernel virtual address KPAGE, which should
+ * come from palloc_get_large().  Both must be aligned on LPGSIZE.
+ * Returns true if successful, false if memory allocation failed
+ * or if any part of UPAGE is already mapped or has a page table.
+ * The mapping is freed as a whole by pml4_destroy(). */
+bool
+pml4_set_large_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	uint64_t *pde;
+
+	ASSERT (((uint64_t) upage & LPGMASK) == 0);
+	ASSERT (((uint64_t) kpage & LPGMASK) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	pde = pde_walk (pml4, (uint64_t) upage, 1);
+	if (pde == NULL || (*pde & PTE_P))
+		return false;
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	large_page_cnt++;
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -313,3 +393,9 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 			invlpg ((uint64_t) vpage);
 	}
 }
+
+/* Prints large page statistics. */
+void
+pml4_print_stats (void) {
+	printf ("Paging: %llu user large pages mapped\n", large_page_cnt);
+}
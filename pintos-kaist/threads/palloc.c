@@ -2,6 +2,7 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -11,6 +12,7 @@
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
@@ -24,13 +26,76 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are managed by a binary buddy
+   allocator.  Free memory is kept as blocks of 2**K pages, aligned
+   to their size, on one free list per order K.  An allocation takes
+   a block from the smallest order that fits, splitting larger ones
+   as needed, and gives back the tail beyond PAGE_CNT.  Freeing a
+   block merges it with its buddy, the other half of the next larger
+   block, for as long as the buddy is also free.  Both take O(log n)
+   time in the pool size.  The free lists are linked through a
+   per-page array beside the bitmap rather than through the pages,
+   because the pools are built before all of memory is mapped.  A
+   used_map bitmap still records which pages are allocated, to catch
+   bad frees.
+
+   Each pool is guarded by a spinlock rather than a sleeping lock,
+   because pages are freed with interrupts off, e.g. when
+   do_schedule() releases a dying thread's stack.
+
+   Each pool also keeps a stash of free pages that are already
+   zeroed, so that single-page PAL_ZERO requests, which come from
+   process creation, exec and page faults, need not clear the page
+   while the caller waits.  When the stash runs low, a work item on
+   the background work queue takes free pages and zeroes them with
+   non-temporal stores, which do not evict the caller's working set
+   from the cache.  Stashed pages are marked used in the bitmap, but
+   they are handed out to any request once the free pages run out. */
+
+/* Number of buddy orders.  The largest block is 2**(BUDDY_ORDERS-1)
+   pages. */
+#define BUDDY_ORDERS 20
+
+/* buddy_order[] value for pages that do not start a free block. */
+#define NOT_FREE 0xff
+
+/* Free list link of a page that starts a free block.  Links are
+   page indexes, with NO_LINK ending a list. */
+struct buddy_link {
+	uint32_t prev;
+	uint32_t next;
+};
+#define NO_LINK UINT32_MAX
+
+/* Zeroed-page stash sizes, per pool. */
+#define ZERO_LOW 16                     /* Refill below this many. */
+#define ZERO_TARGET 64                  /* Refill up to this many. */
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
+	struct spinlock lock;           /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t page_cnt;                /* Pages in pool. */
+
+	/* Buddy allocator. */
+	uint32_t free_lists[BUDDY_ORDERS]; /* First free block of each order. */
+	size_t free_blocks[BUDDY_ORDERS]; /* Lengths of free_lists. */
+	uint32_t free_mask;             /* Bit K set if free_lists[K] is nonempty. */
+	struct buddy_link *links;       /* Per page: free list links. */
+	uint8_t *buddy_order;           /* Per page: order of the free block it
+	                                   starts, or NOT_FREE. */
+	size_t free_cnt;                /* Free pages. */
+	unsigned long long split_cnt;   /* Blocks split by allocations. */
+	unsigned long long merge_cnt;   /* Blocks merged by frees. */
+
+	struct list zero_list;          /* Zeroed pages, linked through their first bytes. */
+	size_t zero_cnt;                /* Pages in zero_list. */
+	struct work zero_work;          /* Refills zero_list. */
+	unsigned long long zero_hits;   /* PAL_ZERO pages taken from zero_list. */
+	unsigned long long zero_misses; /* PAL_ZERO pages cleared inline. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +107,18 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void *zero_pop (struct pool *);
+static void zero_drain (struct pool *);
+static void zero_refill (void *pool_);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void pool_claim (struct pool *, size_t page_idx, size_t page_cnt);
+
+/* pool_alloc() return value on failure. */
+#define NO_PAGES SIZE_MAX
+
+/* Set once the background work queue can take zeroing work. */
+static bool zeroing_started;
 
 /* multiboot info */
 struct multiboot_info {
@@ -219,16 +296,16 @@ split:
 			else
 				NOT_REACHED ();
 
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,19 +339,42 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	void *pages = NULL;
+	bool zeroed = false;
+	bool refill;
+
+	spin_lock (&pool->lock);
+	if (page_cnt == 1 && (flags & PAL_ZERO))
+		zeroed = (pages = zero_pop (pool)) != NULL;
+	if (pages == NULL) {
+		size_t page_idx = pool_alloc (pool, page_cnt);
+
+		if (page_idx == NO_PAGES && pool->zero_cnt > 0) {
+			/* Out of free pages, but the stash is free memory too. */
+			if (page_cnt == 1)
+				zeroed = (pages = zero_pop (pool)) != NULL;
+			else {
+				zero_drain (pool);
+				page_idx = pool_alloc (pool, page_cnt);
+			}
+		}
+		if (page_idx != NO_PAGES)
+			pages = pool->base + PGSIZE * page_idx;
+	}
+	if (flags & PAL_ZERO) {
+		if (zeroed)
+			pool->zero_hits++;
+		else if (pages != NULL)
+			pool->zero_misses++;
+	}
+	refill = zeroing_started && pool->zero_cnt < ZERO_LOW;
+	spin_unlock (&pool->lock);
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
-
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	if (refill)
+		work_submit (&system_bg_wq, &pool->zero_work);
 
 	if (pages) {
-		if (flags & PAL_ZERO)
+		if ((flags & PAL_ZERO) && !zeroed)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
@@ -296,6 +396,102 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Obtains a free large page, LPGSIZE bytes of contiguous memory
+   aligned on an LPGSIZE boundary, and returns its kernel virtual
+   address.  Kernel virtual and physical addresses differ by a
+   multiple of LPGSIZE, so the physical address is aligned too,
+   as a page directory entry requires.  FLAGS are as for
+   palloc_get_multiple().  Free it with palloc_free_multiple() of
+   LPGSIZE / PGSIZE pages.
+
+   The buddy allocator's blocks are aligned relative to the start
+   of the pool, which need not be aligned, so this looks for a free
+   aligned range directly in the bitmap. */
+void *
+palloc_get_large (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t page_cnt = LPGSIZE / PGSIZE;
+	void *pages = NULL;
+	size_t page_idx;
+
+	spin_lock (&pool->lock);
+	page_idx = (ROUND_UP ((uint64_t) pool->base, LPGSIZE)
+			- (uint64_t) pool->base) / PGSIZE;
+	for (; page_idx + page_cnt <= pool->page_cnt; page_idx += page_cnt)
+		if (bitmap_none (pool->used_map, page_idx, page_cnt)) {
+			pool_claim (pool, page_idx, page_cnt);
+			pages = pool->base + PGSIZE * page_idx;
+			break;
+		}
+	spin_unlock (&pool->lock);
+
+	if (pages != NULL) {
+		if (flags & PAL_ZERO)
+			memset (pages, 0, LPGSIZE);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get_large: out of pages");
+	}
+	return pages;
+}
+
+/* Starts filling the zeroed-page stashes.  Called once the
+   background work queue is running. */
+void
+palloc_start_zeroing (void) {
+	zeroing_started = true;
+	work_submit (&system_bg_wq, &kernel_pool.zero_work);
+	work_submit (&system_bg_wq, &user_pool.zero_work);
+}
+
+/* Returns how many PAL_ZERO pages the pool selected by FLAGS has
+   handed out from its zeroed-page stash. */
+unsigned long long
+palloc_zero_hits (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	unsigned long long hits;
+
+	spin_lock (&pool->lock);
+	hits = pool->zero_hits;
+	spin_unlock (&pool->lock);
+	return hits;
+}
+
+/* Prints statistics for POOL, called NAME. */
+static void
+print_pool_stats (const char *name, struct pool *pool) {
+	struct pool p;
+	int largest = -1;
+	int k;
+
+	/* printf() may sleep, so print from a snapshot taken under the
+	   spinlock. */
+	spin_lock (&pool->lock);
+	p = *pool;
+	spin_unlock (&pool->lock);
+
+	if (p.free_mask != 0)
+		largest = 31 - __builtin_clz (p.free_mask);
+	printf ("%s pool: %zu of %zu pages free, largest free block %zu pages, "
+			"%llu splits, %llu merges\n",
+			name, p.free_cnt, p.page_cnt,
+			largest >= 0 ? (size_t) 1 << largest : 0,
+			p.split_cnt, p.merge_cnt);
+	printf ("%s pool: free blocks by order:", name);
+	for (k = 0; k <= largest; k++)
+		printf (" %zu", p.free_blocks[k]);
+	printf ("\n");
+	printf ("%s pool: zeroed pages %llu hits, %llu misses, %zu stashed\n",
+			name, p.zero_hits, p.zero_misses, p.zero_cnt);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	print_pool_stats ("Kernel", &kernel_pool);
+	print_pool_stats ("User", &user_pool);
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
@@ -318,8 +514,45 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	spin_lock (&pool->lock);
+	pool_free (pool, page_idx, page_cnt);
+	spin_unlock (&pool->lock);
+}
+
+/* Tries to grow the run of PAGE_CNT pages at PAGES, obtained from
+   palloc_get_multiple(), to NEW_CNT pages by taking the pages that
+   follow it.  Returns true if successful, false if any of those
+   pages is in use or outside the pool.  The new pages are not
+   cleared. */
+bool
+palloc_extend (void *pages, size_t page_cnt, size_t new_cnt) {
+	struct pool *pool;
+	size_t tail_idx, tail_cnt;
+	bool success = false;
+
+	ASSERT (pg_ofs (pages) == 0);
+	ASSERT (new_cnt >= page_cnt);
+	if (new_cnt == page_cnt)
+		return true;
+
+	if (page_from_pool (&kernel_pool, pages))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, pages))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	tail_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+	tail_cnt = new_cnt - page_cnt;
+
+	spin_lock (&pool->lock);
+	if (tail_idx + tail_cnt <= pool->page_cnt
+			&& bitmap_none (pool->used_map, tail_idx, tail_cnt)) {
+		pool_claim (pool, tail_idx, tail_cnt);
+		success = true;
+	}
+	spin_unlock (&pool->lock);
+	return success;
 }
 
 /* Frees the page at PAGE. */
@@ -336,15 +569,38 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t order_pages = ROUND_UP (pgcnt, PGSIZE);
+	size_t link_pages = ROUND_UP (pgcnt * sizeof (struct buddy_link), PGSIZE);
+	int k;
+
+	ASSERT (pgcnt < NO_LINK);
 
-	lock_init(&p->lock);
+	spin_init (&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->page_cnt = pgcnt;
+
+	/* The per-page arrays follow the bitmap.  Nothing is free until
+	   populate_pools() frees the usable ranges. */
+	p->buddy_order = (uint8_t *) *bm_base + bm_pages;
+	memset (p->buddy_order, NOT_FREE, order_pages);
+	p->links = (struct buddy_link *) (p->buddy_order + order_pages);
+	for (k = 0; k < BUDDY_ORDERS; k++) {
+		p->free_lists[k] = NO_LINK;
+		p->free_blocks[k] = 0;
+	}
+	p->free_mask = 0;
+	p->free_cnt = 0;
+	p->split_cnt = p->merge_cnt = 0;
+	list_init (&p->zero_list);
+	p->zero_cnt = 0;
+	work_init (&p->zero_work, zero_refill, p);
+	p->zero_hits = p->zero_misses = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
 
-	*bm_base += bm_pages;
+	*bm_base += bm_pages + order_pages + link_pages;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -353,6 +609,226 @@ static bool
 page_from_pool (const struct pool *pool, void *page) {
 	size_t page_no = pg_no (page);
 	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
+	size_t end_page = start_page + pool->page_cnt;
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Removes and returns a zeroed page from POOL's stash, or a null
+   pointer if the stash is empty.  POOL's lock must be held. */
+static void *
+zero_pop (struct pool *pool) {
+	struct list_elem *e;
+
+	if (list_empty (&pool->zero_list))
+		return NULL;
+	e = list_pop_front (&pool->zero_list);
+	pool->zero_cnt--;
+
+	/* Only the list element was written since the page was zeroed. */
+	memset (e, 0, sizeof *e);
+	return e;
+}
+
+/* Returns every page in POOL's stash to the free pages, so that
+   multi-page requests can use them.  POOL's lock must be held. */
+static void
+zero_drain (struct pool *pool) {
+	while (!list_empty (&pool->zero_list)) {
+		void *page = list_pop_front (&pool->zero_list);
+		pool_free (pool, pg_no (page) - pg_no (pool->base), 1);
+	}
+	pool->zero_cnt = 0;
+}
+
+/* Fills PAGE with zeros using non-temporal stores, which bypass
+   the cache. */
+static void
+zero_page_nt (void *page) {
+	uint64_t *p = page;
+	uint64_t *end = p + PGSIZE / sizeof *p;
+
+	for (; p < end; p += 4)
+		asm volatile ("movnti %1, (%0)\n\t"
+				"movnti %1, 8(%0)\n\t"
+				"movnti %1, 16(%0)\n\t"
+				"movnti %1, 24(%0)"
+				: : "r" (p), "r" (0ULL) : "memory");
+
+	/* Make the stores visible before the page is handed out. */
+	asm volatile ("sfence" : : : "memory");
+}
+
+/* Work function that tops up the zeroed-page stash of POOL_ from
+   its free pages.  The zeroing itself is done without the lock. */
+static void
+zero_refill (void *pool_) {
+	struct pool *pool = pool_;
+
+	for (;;) {
+		size_t page_idx;
+		void *page;
+
+		spin_lock (&pool->lock);
+		page_idx = pool->zero_cnt < ZERO_TARGET ? pool_alloc (pool, 1) : NO_PAGES;
+		spin_unlock (&pool->lock);
+		if (page_idx == NO_PAGES)
+			break;
+
+		page = pool->base + PGSIZE * page_idx;
+		zero_page_nt (page);
+
+		spin_lock (&pool->lock);
+		list_push_front (&pool->zero_list, page);
+		pool->zero_cnt++;
+		spin_unlock (&pool->lock);
+	}
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX on POOL's free
+   list for ORDER. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order) {
+	struct buddy_link *link = &pool->links[page_idx];
+	uint32_t head = pool->free_lists[order];
+
+	pool->buddy_order[page_idx] = order;
+	link->prev = NO_LINK;
+	link->next = head;
+	if (head != NO_LINK)
+		pool->links[head].prev = page_idx;
+	pool->free_lists[order] = page_idx;
+	pool->free_blocks[order]++;
+	pool->free_mask |= 1u << order;
+}
+
+/* Takes the free block of 2**ORDER pages at PAGE_IDX off POOL's
+   free list for ORDER. */
+static void
+remove_block (struct pool *pool, size_t page_idx, int order) {
+	struct buddy_link *link = &pool->links[page_idx];
+
+	ASSERT (pool->buddy_order[page_idx] == order);
+
+	pool->buddy_order[page_idx] = NOT_FREE;
+	if (link->prev != NO_LINK)
+		pool->links[link->prev].next = link->next;
+	else
+		pool->free_lists[order] = link->next;
+	if (link->next != NO_LINK)
+		pool->links[link->next].prev = link->prev;
+	if (--pool->free_blocks[order] == 0)
+		pool->free_mask &= ~(1u << order);
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX, which must be
+   aligned to its size, merging it with its buddy for as long as
+   the buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) {
+	while (order < BUDDY_ORDERS - 1) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy + ((size_t) 1 << order) > pool->page_cnt
+				|| pool->buddy_order[buddy] != order)
+			break;
+		remove_block (pool, buddy, order);
+		pool->merge_cnt++;
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	push_block (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, which need not
+   form a single block.  POOL's lock must be held, or the pool not
+   yet in use. */
+static void
+pool_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool->free_cnt += page_cnt;
+
+	/* Split the range into the largest aligned blocks it holds. */
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order < BUDDY_ORDERS - 1
+				&& (page_idx & ((size_t) 1 << order)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Allocates the PAGE_CNT pages at PAGE_IDX in POOL, all of which
+   must be free.  Each free block that overlaps the range is taken
+   off its free list and whatever part of it lies outside the range
+   is freed again.  POOL's lock must be held. */
+static void
+pool_claim (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	size_t end = page_idx + page_cnt;
+
+	while (page_idx < end) {
+		size_t start = page_idx, block_end;
+		int order = 0;
+
+		/* Find the free block containing PAGE_IDX. */
+		while (pool->buddy_order[start] != order) {
+			order++;
+			ASSERT (order < BUDDY_ORDERS);
+			start = page_idx & ~(((size_t) 1 << order) - 1);
+		}
+		block_end = start + ((size_t) 1 << order);
+
+		remove_block (pool, start, order);
+		bitmap_set_multiple (pool->used_map, start, (size_t) 1 << order, true);
+		pool->free_cnt -= (size_t) 1 << order;
+		if (start < page_idx)
+			pool_free (pool, start, page_idx - start);
+		if (block_end > end)
+			pool_free (pool, end, block_end - end);
+		page_idx = block_end;
+	}
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or NO_PAGES if no free block is large
+   enough.  POOL's lock must be held. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt) {
+	size_t page_idx;
+	int order, k;
+
+	ASSERT (page_cnt > 0);
+
+	for (order = 0; ((size_t) 1 << order) < page_cnt; order++)
+		if (order == BUDDY_ORDERS - 1)
+			return NO_PAGES;
+
+	/* Smallest nonempty order that is large enough. */
+	if ((pool->free_mask >> order) == 0)
+		return NO_PAGES;
+	k = order + __builtin_ctz (pool->free_mask >> order);
+
+	page_idx = pool->free_lists[k];
+	remove_block (pool, page_idx, k);
+
+	/* Split off the upper halves until the block has the requested
+	   order. */
+	while (k > order) {
+		k--;
+		push_block (pool, page_idx + ((size_t) 1 << k), k);
+		pool->split_cnt++;
+	}
+
+	bitmap_set_multiple (pool->used_map, page_idx, (size_t) 1 << order, true);
+	pool->free_cnt -= (size_t) 1 << order;
+
+	/* Return the unused tail. */
+	if (page_cnt < ((size_t) 1 << order))
+		pool_free (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
@@ -0,0 +1,208 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Object caches for frequently created kernel objects.
+
+   A cache hands out objects of a single size.  Freed objects are
+   pushed on the front of the cache's free list and the next
+   allocation pops the most recently freed one, which is still
+   warm in the CPU cache.  Objects are not cleared on either path;
+   that is left to the caller, who knows which fields matter.
+
+   Objects smaller than half a page live in "slabs": a page with a
+   small header followed by as many objects as fit, in the same
+   way that malloc() carves up its arenas.  When every object in a
+   slab is free and the cache still has RESERVE other free objects,
+   the slab is returned to the page allocator.
+
+   Page-sized objects, such as a thread's struct thread and kernel
+   stack, have no room for a header.  The cache simply keeps up to
+   RESERVE freed pages around and gives the rest back to the page
+   allocator.
+
+   Caches are protected by a spinlock, so objects may be freed with
+   interrupts off, e.g. from the scheduler. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header, at the start of each slab page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct slab_cache *cache;   /* Owning cache. */
+	size_t free_cnt;            /* Free objects in this slab. */
+};
+
+/* Free object. */
+struct slab_obj {
+	struct list_elem free_elem; /* Free list element. */
+};
+
+/* Registered caches, for slab_print_stats(). */
+static struct slab_cache *caches[16];
+static size_t cache_cnt;
+
+static struct slab *obj_to_slab (struct slab_cache *, struct slab_obj *);
+static struct slab_obj *slab_to_obj (struct slab *, size_t idx);
+
+/* Initializes cache C for objects of OBJ_SIZE bytes, keeping up
+   to RESERVE free objects for reuse.  OBJ_SIZE must either be
+   PGSIZE or at most half a page.  Does not allocate memory, so it
+   may be called before the page allocator is initialized. */
+void
+slab_cache_init (struct slab_cache *c, const char *name,
+		size_t obj_size, size_t reserve) {
+	ASSERT (c != NULL && name != NULL);
+	ASSERT (obj_size == PGSIZE || obj_size <= PGSIZE / 2);
+	ASSERT (cache_cnt < sizeof caches / sizeof *caches);
+
+	c->name = name;
+	if (obj_size == PGSIZE) {
+		c->obj_size = PGSIZE;
+		c->objs_per_slab = 0;
+	} else {
+		c->obj_size = ROUND_UP (obj_size < sizeof (struct slab_obj)
+				? sizeof (struct slab_obj) : obj_size, sizeof (void *));
+		c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / c->obj_size;
+	}
+	c->reserve = reserve;
+	spin_init (&c->lock);
+	list_init (&c->free_list);
+	c->free_cnt = 0;
+	c->hits = 0;
+	c->misses = 0;
+	caches[cache_cnt++] = c;
+}
+
+/* Obtains an object from cache C.  The object's contents are
+   unspecified.  Returns a null pointer if memory is not
+   available. */
+void *
+slab_alloc (struct slab_cache *c) {
+	struct slab_obj *o = NULL;
+	struct slab *s;
+	size_t i;
+
+	spin_lock (&c->lock);
+	if (!list_empty (&c->free_list)) {
+		o = list_entry (list_pop_front (&c->free_list), struct slab_obj, free_elem);
+		c->free_cnt--;
+		c->hits++;
+		if (c->objs_per_slab != 0)
+			obj_to_slab (c, o)->free_cnt--;
+	} else
+		c->misses++;
+	spin_unlock (&c->lock);
+	if (o != NULL)
+		return o;
+
+	/* Free list is empty.  Call the page allocator without the
+	   spinlock held: it takes its pool's own lock and may
+	   work_submit() a refill of the zeroed-page stash, and neither
+	   should nest inside the cache lock. */
+	s = palloc_get_page (0);
+	if (s == NULL || c->objs_per_slab == 0)
+		return s;
+
+	/* Set up a new slab, keep its first object and put the rest on
+	   the free list. */
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free_cnt = c->objs_per_slab - 1;
+	spin_lock (&c->lock);
+	for (i = 1; i < c->objs_per_slab; i++)
+		list_push_back (&c->free_list, &slab_to_obj (s, i)->free_elem);
+	c->free_cnt += c->objs_per_slab - 1;
+	spin_unlock (&c->lock);
+	return slab_to_obj (s, 0);
+}
+
+/* Returns object P, which must have been obtained from cache C
+   with slab_alloc(), to the cache.  A null P is ignored. */
+void
+slab_free (struct slab_cache *c, void *p) {
+	struct slab_obj *o = p;
+	struct slab *s;
+	size_t i;
+
+	if (p == NULL)
+		return;
+
+	spin_lock (&c->lock);
+	if (c->objs_per_slab == 0) {
+		ASSERT (pg_ofs (p) == 0);
+		if (c->free_cnt < c->reserve) {
+			list_push_front (&c->free_list, &o->free_elem);
+			c->free_cnt++;
+			o = NULL;
+		}
+		spin_unlock (&c->lock);
+		if (o != NULL)
+			palloc_free_page (o);
+		return;
+	}
+
+	s = obj_to_slab (c, o);
+	list_push_front (&c->free_list, &o->free_elem);
+	c->free_cnt++;
+
+	/* If the slab is now entirely unused and we have enough other
+	   free objects, give it back. */
+	if (++s->free_cnt >= c->objs_per_slab
+			&& c->free_cnt - c->objs_per_slab >= c->reserve) {
+		ASSERT (s->free_cnt == c->objs_per_slab);
+		for (i = 0; i < c->objs_per_slab; i++)
+			list_remove (&slab_to_obj (s, i)->free_elem);
+		c->free_cnt -= c->objs_per_slab;
+	} else
+		s = NULL;
+	spin_unlock (&c->lock);
+
+	if (s != NULL)
+		palloc_free_page (s);
+}
+
+/* Prints hit rates of all caches. */
+void
+slab_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < cache_cnt; i++) {
+		struct slab_cache *c = caches[i];
+		unsigned long long total = c->hits + c->misses;
+
+		printf ("Slab %s: %llu hits, %llu misses (%llu%% hit rate), %zu free\n",
+				c->name, c->hits, c->misses,
+				total != 0 ? c->hits * 100 / total : 0, c->free_cnt);
+	}
+}
+
+/* Returns the slab that object O is inside. */
+static struct slab *
+obj_to_slab (struct slab_cache *c, struct slab_obj *o) {
+	struct slab *s = pg_round_down (o);
+
+	/* Check that the slab is valid and that O is aligned for it. */
+	ASSERT (s != NULL);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT ((pg_ofs (o) - sizeof *s) % c->obj_size == 0);
+
+	return s;
+}
+
+/* Returns the IDX'th object within slab S. */
+static struct slab_obj *
+slab_to_obj (struct slab *s, size_t idx) {
+	ASSERT (s != NULL);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (idx < s->cache->objs_per_slab);
+	return (struct slab_obj *) ((uint8_t *) s
+			+ sizeof *s
+			+ idx * s->cache->obj_size);
+}
@@ -31,11 +31,49 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Thread whose stack we are running on.  Unlike thread_current(),
+   this does not insist on THREAD_RUNNING, so it also works inside
+   schedule() where the outgoing thread has already changed state. */
+#define running_thread() ((struct thread *) (pg_round_down (rrsp ())))
 
 /*------------------[Project1 - Thread]------------------*/
 void remove_with_lock(struct lock *lock);
 void donate_priority(void);
 void refresh_priority(void);
+static int rwlock_donated_priority (struct thread *);
+static void rwlock_donate (struct rwlock *, int priority);
+
+/* Arrival order of waiters, for FIFO order among equal
+   priorities.  Protected by disabling interrupts. */
+static unsigned long long next_wait_seq;
+
+/* Semaphore waiter order: higher priority first, then FIFO. */
+static bool
+sema_waiter_before (const struct pheap_elem *a_, const struct pheap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = pheap_entry (a_, struct thread, wait_elem);
+	const struct thread *b = pheap_entry (b_, struct thread, wait_elem);
+
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->wait_seq < b->wait_seq;
+}
+
+/* Condition waiter order: higher priority first, then FIFO. */
+static bool
+cond_waiter_before (const struct pheap_elem *a_, const struct pheap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = pheap_entry (a_, struct thread, cond_elem);
+	const struct thread *b = pheap_entry (b_, struct thread, cond_elem);
+
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->cond_seq < b->cond_seq;
+}
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -51,7 +89,7 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	pheap_init (&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -71,7 +109,12 @@ sema_down (struct semaphore *sema) {
 
 	old_level = intr_disable ();
 	while (sema->value == 0) {
-		list_insert_ordered(&sema->waiters, &thread_current ()->elem, priority_more, NULL);
+		struct thread *curr = thread_current ();
+
+		curr->wait_seq = next_wait_seq++;
+		curr->wait_sema = sema;
+		pheap_push (&sema->waiters, &curr->wait_elem, sema_waiter_before, NULL);
+		trace_sema_block (sema);
 		thread_block ();
 	}
 	sema->value--;
@@ -115,13 +158,12 @@ sema_up (struct semaphore *sema) {
 
 	old_level = intr_disable ();
 	sema->value++;
-	if (!list_empty (&sema->waiters)){
-		list_sort(&sema->waiters, priority_more, NULL);
-		struct thread *curr = list_entry(list_pop_front(&sema->waiters), struct thread, elem);
+	if (!pheap_empty (&sema->waiters)){
+		struct thread *curr = pheap_entry (pheap_pop (&sema->waiters,
+					sema_waiter_before, NULL), struct thread, wait_elem);
+		curr->wait_sema = NULL;
 		thread_unblock(curr);
-		if(thread_current()->priority < curr->priority){
-			thread_yield();
-		}
+		thread_preempt_check(curr);
 	}
 		
 	intr_set_level (old_level);
@@ -162,6 +204,54 @@ sema_test_helper (void *sema_) {
 	}
 }
 
+/* Held lock order: highest donation first. */
+static bool
+lock_donated_more (const struct pheap_elem *a_, const struct pheap_elem *b_,
+		void *aux UNUSED) {
+	const struct lock *a = pheap_entry (a_, struct lock, held_elem);
+	const struct lock *b = pheap_entry (b_, struct lock, held_elem);
+
+	return a->donated > b->donated;
+}
+
+/* Makes the current thread, which has just downed LOCK's
+   semaphore, its holder.  Threads still waiting for LOCK (e.g.
+   because we took it ahead of a thread that sema_up() woke)
+   donate to us right away. */
+static void
+lock_take (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	struct pheap_elem *top;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	lock->holder = curr;
+	top = pheap_top (&lock->semaphore.waiters);
+	lock->donated = top != NULL
+		? pheap_entry (top, struct thread, wait_elem)->priority : PRI_MIN - 1;
+	pheap_push (&curr->held_locks, &lock->held_elem, lock_donated_more, NULL);
+	if (!thread_mlfqs && curr->priority < lock->donated)
+		curr->priority = lock->donated;
+	intr_set_level (old_level);
+}
+
+/* Takes LOCK if it is free and returns true, otherwise returns
+   false.  Downing the semaphore and becoming the holder happen
+   with interrupts off, so no thread can find the lock taken but
+   without a holder to donate to. */
+static bool
+lock_try_take (struct lock *lock) {
+	enum intr_level old_level;
+	bool success;
+
+	old_level = intr_disable ();
+	success = sema_try_down (&lock->semaphore);
+	if (success)
+		lock_take (lock);
+	intr_set_level (old_level);
+	return success;
+}
+
 /* Initializes LOCK.  A lock can be held by at most a single
    thread at any given time.  Our locks are not "recursive", that
    is, it is an error for the thread currently holding a lock to
@@ -183,6 +273,71 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	lock->donated = PRI_MIN - 1;
+	lock->name = NULL;
+	lock->acquires = lock->spins = lock->sleeps = 0;
+}
+
+/* Adaptive locks, for statistics. */
+static struct lock *adaptive_locks[16];
+static size_t adaptive_lock_cnt;
+
+#if NCPU > 1
+/* Upper bound on spin iterations before an adaptive lock gives up
+   and blocks, even if the holder is still running. */
+#define LOCK_SPIN_LIMIT 1000
+#endif
+
+/* Initializes LOCK as an adaptive lock named NAME.  An adaptive
+   lock behaves like any other lock, except that a contending
+   thread first spins for a short while as long as the holder is
+   running on another CPU, on the theory that a critical section
+   that short will be over before a context switch would be.  It
+   only blocks, donating its priority, if the holder is not
+   running or the spin runs too long.  Use it for locks held for a
+   few microseconds at a time.
+
+   With NCPU == 1 the holder can never be running elsewhere, so
+   the spin phase is compiled out and an adaptive lock differs
+   from a plain one only in keeping statistics.  The statistics
+   are updated by the new holder while it holds LOCK, so LOCK
+   itself protects them. */
+void
+lock_init_adaptive (struct lock *lock, const char *name) {
+	ASSERT (name != NULL);
+
+	lock_init (lock);
+	lock->name = name;
+	if (adaptive_lock_cnt < sizeof adaptive_locks / sizeof *adaptive_locks)
+		adaptive_locks[adaptive_lock_cnt++] = lock;
+}
+
+#if NCPU > 1
+/* Spins on adaptive LOCK while its holder is running on another
+   CPU.  Returns true if the lock was acquired. */
+static bool
+lock_spin (struct lock *lock) {
+	for (int i = 0; i < LOCK_SPIN_LIMIT; i++) {
+		struct thread *holder = __atomic_load_n (&lock->holder, __ATOMIC_RELAXED);
+
+		if (lock_try_take (lock))
+			return true;
+		if (holder == NULL || !thread_running_elsewhere (holder))
+			return false;
+		asm volatile ("pause");
+	}
+	return false;
+}
+#endif
+
+/* Prints statistics for adaptive locks. */
+void
+lock_print_stats (void) {
+	for (size_t i = 0; i < adaptive_lock_cnt; i++) {
+		struct lock *lock = adaptive_locks[i];
+		printf ("Lock %s: %llu uncontended, %llu spun, %llu slept\n",
+				lock->name, lock->acquires, lock->spins, lock->sleeps);
+	}
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -195,18 +350,44 @@ lock_init (struct lock *lock) {
    we need to sleep. */
 void
 lock_acquire (struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	if(lock->holder != NULL){
+	/* Adaptive lock: take it if free, or spin while the holder runs
+	   elsewhere.  Nothing has been donated yet, so there is nothing
+	   to undo if this works. */
+	if (lock->name != NULL) {
+		if (lock_try_take (lock)) {
+			lock->acquires++;
+			return;
+		}
+#if NCPU > 1
+		if (lock_spin (lock)) {
+			lock->spins++;
+			return;
+		}
+#endif
+	}
+
+	old_level = intr_disable ();
+	/* Only a wait that may block counts toward the lock-wait
+	   histogram. */
+	if (lock->semaphore.value == 0)
+		trace_lock_wait (lock);
+	if(lock->holder != NULL && !thread_mlfqs){
 		thread_current()->wait_on_lock = lock;
-		list_insert_ordered(&lock->holder->donations, &thread_current()->d_elem, cmp_d_elem_priority, NULL);
 		donate_priority();
 	}
 	sema_down(&lock->semaphore);
 	thread_current()->wait_on_lock = NULL;
-	lock->holder = thread_current ();
+	lock_take (lock);
+	if (lock->name != NULL)
+		lock->sleeps++;
+	trace_lock_acquired (lock);
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -217,15 +398,10 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
-	bool success;
-
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	success = sema_try_down (&lock->semaphore);
-	if (success)
-		lock->holder = thread_current ();
-	return success;
+	return lock_try_take (lock);
 }
 
 /* Releases LOCK, which must be owned by the current thread.
@@ -239,11 +415,15 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	remove_with_lock(lock);
-	refresh_priority();
 
+	enum intr_level old_level = intr_disable ();
+	pheap_remove (&thread_current ()->held_locks, &lock->held_elem,
+			lock_donated_more, NULL);
 	lock->holder = NULL;
+	if (!thread_mlfqs)
+		refresh_priority();
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -256,87 +436,402 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
-	struct semaphore semaphore;         /* This semaphore. */
-};
+/* Initializes spinlock SL as unheld. */
+void
+spin_init (struct spinlock *sl) {
+	ASSERT (sl != NULL);
+
+	sl->locked = 0;
+	sl->holder = NULL;
+	sl->old_level = INTR_OFF;
+}
+
+/* Acquires SL, spinning until it becomes available.  Interrupts
+   are disabled until the matching spin_unlock(), so a CPU holding
+   a spinlock is never preempted and never re-enters it from an
+   interrupt handler.
+
+   This function never sleeps, so it may be called from an
+   interrupt handler. */
+void
+spin_lock (struct spinlock *sl) {
+	enum intr_level old_level;
+
+	ASSERT (sl != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (!spin_held_by_current_thread (sl));
+	while (__atomic_exchange_n (&sl->locked, 1, __ATOMIC_ACQUIRE))
+		while (sl->locked)
+			asm volatile ("pause");
+	sl->holder = running_thread ();
+	sl->old_level = old_level;
+}
+
+/* Releases SL, which must be held by the current thread, and
+   restores the interrupt level saved by spin_lock(). */
+void
+spin_unlock (struct spinlock *sl) {
+	enum intr_level old_level;
+
+	ASSERT (spin_held_by_current_thread (sl));
+
+	old_level = sl->old_level;
+	sl->holder = NULL;
+	__atomic_store_n (&sl->locked, 0, __ATOMIC_RELEASE);
+	intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds SL. */
+bool
+spin_held_by_current_thread (const struct spinlock *sl) {
+	ASSERT (sl != NULL);
+
+	return sl->locked && sl->holder == running_thread ();
+}
 
 /*------------------[Project1 - Thread]------------------*/
-/* 현재 락을 들고 있는 쓰레드에게 우선순위 전달(depth 8까지)*/
-void donate_priority(void)
-{
-	ASSERT(thread_current()->wait_on_lock != NULL);
-	struct thread *curr_lock_holder = thread_current()->wait_on_lock->holder;
-	int depth = 8;
+/* Donation.
+
+   Each lock remembers in DONATED the highest priority among the
+   threads waiting for it, and each thread keeps the locks it
+   holds in HELD_LOCKS, a heap ordered by DONATED.  A thread's
+   priority is then the larger of its own priority and the top of
+   that heap, so giving up a lock costs a heap removal instead of
+   a walk over every donor.
+
+   A new waiter raises DONATED of the lock it waits for, which may
+   raise the holder's priority, which in turn raises DONATED of
+   the lock the holder waits for, and so on.  A holder blocked on
+   an rwlock passes the donation on to that rwlock's holders
+   instead.  The walk stops at the first lock whose donation does
+   not change.  There is no
+   depth limit: every step strictly raises some lock's DONATED,
+   so even a deadlocked cycle terminates. */
+
+/* Raises LOCK's donation to PRIORITY and passes it on along the
+   chain of holders.  Interrupts must be off. */
+static void
+donate_to_lock (struct lock *lock, int priority) {
+	ASSERT (intr_get_level () == INTR_OFF);
 
-	while(thread_get_priority() > curr_lock_holder->priority){
-		if(depth-- <= 0) break;
-		curr_lock_holder->priority = thread_get_priority();
+	while (lock != NULL && lock->holder != NULL && lock->donated < priority) {
+		struct thread *holder = lock->holder;
 
-		if(curr_lock_holder->wait_on_lock != NULL){
-			curr_lock_holder = curr_lock_holder->wait_on_lock->holder;
-		}else{
+		pheap_remove (&holder->held_locks, &lock->held_elem, lock_donated_more, NULL);
+		lock->donated = priority;
+		pheap_push (&holder->held_locks, &lock->held_elem, lock_donated_more, NULL);
+		if (holder->priority >= priority)
+			break;
+		holder->priority = priority;
+		thread_reposition_ready (holder);
+		if (holder->wait_on_rwlock != NULL) {
+			rwlock_donate (holder->wait_on_rwlock, priority);
 			break;
 		}
+		lock = holder->wait_on_lock;
 	}
 }
 
-void remove_with_lock(struct lock *lock)
+/* 현재 쓰레드가 기다리는 락의 holder에게 우선순위를 전달한다.
+   인터럽트는 꺼져 있어야 한다. */
+void donate_priority(void)
 {
-	struct list_elem *curr = list_begin(&thread_current()->donations);
-	struct thread *curr_thread;
+	ASSERT(thread_current()->wait_on_lock != NULL);
+	donate_to_lock (thread_current ()->wait_on_lock, thread_get_priority ());
+}
 
-	// donations의 시작부터 끝까지 순회하며 현재 쓰레드의 wait_on_lock이 지우려는 lock과 일치하면 삭제한다
-	while (curr != list_end(&thread_current()->donations))
-	{
-		curr_thread = list_entry(curr, struct thread, d_elem);
-		if (curr_thread->wait_on_lock == lock)
-		{
-			curr = list_remove(curr);
-		}
+/* 원래 우선순위, 들고 있는 락과 rwlock이 받은 donation 중 가장 큰 값으로
+   현재 쓰레드의 우선순위를 다시 계산한다. cond_wait()은 condition의 waiter
+   heap에 들어간 뒤 lock을 놓으므로, 그때 바뀐 우선순위로 heap 안의 위치도
+   고친다. */
+void refresh_priority(void){
+	struct thread *curr = thread_current ();
+	struct pheap_elem *top = pheap_top (&curr->held_locks);
+	int priority = curr->origin_priority;
+
+	if (top != NULL && pheap_entry (top, struct lock, held_elem)->donated > priority)
+		priority = pheap_entry (top, struct lock, held_elem)->donated;
+
+	/* 들고 있는 rwlock을 기다리는 쓰레드들의 donation. */
+	int rw_priority = rwlock_donated_priority (curr);
+	if (priority < rw_priority)
+		priority = rw_priority;
+	if (curr->priority != priority) {
+		curr->priority = priority;
+		if (curr->wait_cond != NULL)
+			waiter_reposition (curr);
+	}
+}
+
+/* 우선순위가 바뀐 BLOCKED 쓰레드 T(또는 cond_wait()에서 lock을 놓는 중인
+   현재 쓰레드)를 기다리던 semaphore와 condition의 waiter heap 안에서 새
+   위치로 옮긴다. 리스트 전체를 다시 정렬하지 않고
+   T 하나만 빼서 다시 넣는다. 인터럽트는 꺼져 있어야 한다. */
+void
+waiter_reposition (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->wait_sema != NULL) {
+		struct pheap *waiters = &t->wait_sema->waiters;
+		pheap_remove (waiters, &t->wait_elem, sema_waiter_before, NULL);
+		pheap_push (waiters, &t->wait_elem, sema_waiter_before, NULL);
+	}
+	if (t->wait_cond != NULL) {
+		struct pheap *waiters = &t->wait_cond->waiters;
+		pheap_remove (waiters, &t->cond_elem, cond_waiter_before, NULL);
+		pheap_push (waiters, &t->cond_elem, cond_waiter_before, NULL);
+	}
+}
+
+/* Initializes RW as an unheld reader-writer lock. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	rw->readers = 0;
+	rw->writer = NULL;
+	list_init (&rw->holds);
+	list_init (&rw->read_waiters);
+	list_init (&rw->write_waiters);
+}
+
+/* Returns T's record of holding RW, or NULL if T does not hold
+   it. */
+static struct rw_hold *
+rw_hold_find (struct rwlock *rw, struct thread *t) {
+	for (int i = 0; i < RWLOCK_HOLD_MAX; i++)
+		if (t->rw_holds[i].rw == rw)
+			return &t->rw_holds[i];
+	return NULL;
+}
+
+/* Records that T now holds RW, as a reader if READER is true.
+   Interrupts must be off. */
+static void
+rw_hold_add (struct rwlock *rw, struct thread *t, bool reader) {
+	struct rw_hold *h = rw_hold_find (NULL, t);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (h == NULL)
+		PANIC ("%s holds more than %d rwlocks", t->name, RWLOCK_HOLD_MAX);
+	h->rw = rw;
+	h->t = t;
+	if (reader)
+		list_push_back (&rw->holds, &h->elem);
+}
+
+/* Returns the highest-priority thread on waiter list LIST, the
+   earliest one among equals, or NULL if LIST is empty. */
+static struct thread *
+rw_max_waiter (struct list *list) {
+	if (list_empty (list))
+		return NULL;
+	return list_entry (list_min (list, priority_more, NULL), struct thread, elem);
+}
+
+/* Returns the highest priority among RW's waiters, or PRI_MIN - 1
+   if there are none. */
+static int
+rw_max_waiter_priority (struct rwlock *rw) {
+	struct thread *r = rw_max_waiter (&rw->read_waiters);
+	struct thread *w = rw_max_waiter (&rw->write_waiters);
+	int priority = PRI_MIN - 1;
+
+	if (r != NULL)
+		priority = r->priority;
+	if (w != NULL && w->priority > priority)
+		priority = w->priority;
+	return priority;
+}
+
+/* Raises T to PRIORITY, following the chain of locks and rwlocks
+   T waits on, like donate_priority(). */
+static void
+donate_to (struct thread *t, int priority) {
+	if (t->priority < priority) {
+		t->priority = priority;
+		thread_reposition_ready (t);
+		if (t->wait_on_rwlock != NULL)
+			rwlock_donate (t->wait_on_rwlock, priority);
 		else
-		{
-			curr = curr->next;
+			donate_to_lock (t->wait_on_lock, priority);
+	}
+}
+
+/* Donates PRIORITY to every thread holding RW: the writer, or all
+   of the readers.  Interrupts must be off. */
+static void
+rwlock_donate (struct rwlock *rw, int priority) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (thread_mlfqs)
+		return;
+
+	if (rw->writer != NULL)
+		donate_to (rw->writer, priority);
+	for (e = list_begin (&rw->holds); e != list_end (&rw->holds); e = list_next (e))
+		donate_to (list_entry (e, struct rw_hold, elem)->t, priority);
+}
+
+/* Highest priority donated to T through the rwlocks it holds. */
+static int
+rwlock_donated_priority (struct thread *t) {
+	int priority = PRI_MIN - 1;
+
+	for (int i = 0; i < RWLOCK_HOLD_MAX; i++) {
+		struct rwlock *rw = t->rw_holds[i].rw;
+		if (rw != NULL) {
+			int p = rw_max_waiter_priority (rw);
+			if (p > priority)
+				priority = p;
 		}
 	}
+	return priority;
 }
 
-/* donations 리스트가 수정되었을 떄 우선순위를 다시 정렬해놓기 위한 함수 */
-void refresh_priority(void){
-	struct list_elem *donation_elem;
-	struct list *curr_donations = &thread_current()->donations;
-	int donations_priority;
-
-	thread_current()->priority = thread_current()->origin_priority;
-	if(!list_empty(curr_donations)){
-		list_sort(curr_donations, cmp_d_elem_priority, NULL);
-		donation_elem = list_begin(curr_donations);
-		donations_priority = list_entry(donation_elem, struct thread, d_elem)->priority;
-		if(thread_get_priority() < donations_priority){
-			thread_current()->priority = donations_priority;
+/* Hands free RW to its waiters: the highest-priority writer, or
+   every waiting reader if a reader outranks all writers.  Ties go
+   to the writer.  The new holders inherit donations from whoever
+   is still waiting.  Returns the highest-priority thread woken,
+   or a null pointer if none was.  Interrupts must be off. */
+static struct thread *
+rwlock_wake (struct rwlock *rw) {
+	struct thread *r = rw_max_waiter (&rw->read_waiters);
+	struct thread *w = rw_max_waiter (&rw->write_waiters);
+	struct thread *woken;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (rw->writer == NULL && rw->readers == 0);
+
+	if (w != NULL && (r == NULL || w->priority >= r->priority)) {
+		list_remove (&w->elem);
+		w->wait_on_rwlock = NULL;
+		rw->writer = w;
+		rw_hold_add (rw, w, false);
+		thread_unblock (w);
+		woken = w;
+	} else if (r != NULL) {
+		while (!list_empty (&rw->read_waiters)) {
+			struct thread *t = list_entry (list_pop_front (&rw->read_waiters),
+					struct thread, elem);
+			t->wait_on_rwlock = NULL;
+			rw->readers++;
+			rw_hold_add (rw, t, true);
+			thread_unblock (t);
 		}
+		woken = r;
+	} else
+		return NULL;
+
+	rwlock_donate (rw, rw_max_waiter_priority (rw));
+	return woken;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or is
+   waiting for it.  The current thread must not already hold RW.
+   The uncontended case only bumps the reader count and never
+   touches the waiter lists.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw_hold_find (rw, curr) == NULL);
+
+	old_level = intr_disable ();
+	if (rw->writer == NULL && list_empty (&rw->write_waiters)) {
+		rw->readers++;
+		rw_hold_add (rw, curr, true);
+	} else {
+		list_push_back (&rw->read_waiters, &curr->elem);
+		curr->wait_on_rwlock = rw;
+		rwlock_donate (rw, curr->priority);
+		thread_block ();        /* rwlock_wake() hands us the lock. */
 	}
+	intr_set_level (old_level);
 }
 
-bool cmp_sema_priority(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED)
-{
-	struct semaphore *sema_a = &list_entry(a_, struct semaphore_elem, elem)->semaphore;
-	struct semaphore *sema_b = &list_entry(b_, struct semaphore_elem, elem)->semaphore;
+/* Acquires RW for writing, sleeping while anyone else holds it.
+   The current thread must not already hold RW.
 
-	struct thread *a = list_entry(list_begin(&(sema_a)->waiters), struct thread, elem);
-	struct thread *b = list_entry(list_begin(&(sema_b)->waiters), struct thread, elem);
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw_hold_find (rw, curr) == NULL);
 
-	return a->priority > b->priority;
+	old_level = intr_disable ();
+	if (rw->writer == NULL && rw->readers == 0) {
+		rw->writer = curr;
+		rw_hold_add (rw, curr, false);
+	} else {
+		list_push_back (&rw->write_waiters, &curr->elem);
+		curr->wait_on_rwlock = rw;
+		rwlock_donate (rw, curr->priority);
+		thread_block ();        /* rwlock_wake() hands us the lock. */
+	}
+	intr_set_level (old_level);
 }
 
-// donation element 우선순위 정렬 함수
-bool cmp_d_elem_priority(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED)
-{
-	struct thread *a = list_entry(a_, struct thread, d_elem);
-	struct thread *b = list_entry(b_, struct thread, d_elem);
+/* Drops the current thread's hold on RW and any priority it was
+   donated through RW, and hands RW on if it became free. */
+static void
+rwlock_release (struct rwlock *rw, struct rw_hold *h) {
+	struct thread *woken = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (rw->writer != NULL) {
+		rw->writer = NULL;
+		woken = rwlock_wake (rw);
+	} else {
+		list_remove (&h->elem);
+		if (--rw->readers == 0)
+			woken = rwlock_wake (rw);
+	}
+	h->rw = NULL;
+	if (!thread_mlfqs)
+		refresh_priority ();
+	/* Still with interrupts off, so WOKEN cannot have run and exited. */
+	if (woken != NULL)
+		thread_preempt_check (woken);
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for reading. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	struct rw_hold *h;
+
+	ASSERT (rw != NULL);
 
-	return a->priority > b->priority;
+	h = rw_hold_find (rw, thread_current ());
+	ASSERT (h != NULL && rw->writer == NULL);
+	rwlock_release (rw, h);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	struct rw_hold *h;
+
+	ASSERT (rw != NULL);
+
+	h = rw_hold_find (rw, thread_current ());
+	ASSERT (h != NULL && rw->writer == thread_current ());
+	rwlock_release (rw, h);
 }
 
 /* Initializes condition variable COND.  A condition variable
@@ -346,7 +841,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	pheap_init (&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -371,17 +866,24 @@ cond_init (struct condition *cond) {
    we need to sleep. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
-	struct semaphore_elem waiter;
+	struct thread *curr = thread_current ();
+	struct semaphore waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	sema_init (&waiter.semaphore, 0);
-	list_insert_ordered(&cond->waiters, &waiter.elem, cmp_sema_priority, NULL);
+	sema_init (&waiter, 0);
+	old_level = intr_disable ();
+	curr->cond_seq = next_wait_seq++;
+	curr->wait_cond = cond;
+	curr->cond_sema = &waiter;
+	pheap_push (&cond->waiters, &curr->cond_elem, cond_waiter_before, NULL);
+	intr_set_level (old_level);
 	lock_release (lock);
-	sema_down (&waiter.semaphore);
+	sema_down (&waiter);
 	lock_acquire (lock);
 }
 
@@ -399,10 +901,14 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters)){
-		list_sort(&cond->waiters, cmp_sema_priority, NULL);
-		sema_up(&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
+	enum intr_level old_level = intr_disable ();
+	if (!pheap_empty (&cond->waiters)){
+		struct thread *t = pheap_entry (pheap_pop (&cond->waiters,
+					cond_waiter_before, NULL), struct thread, cond_elem);
+		t->wait_cond = NULL;
+		sema_up (t->cond_sema);
 	}
+	intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -416,6 +922,10 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	/* Wake everyone first and switch at most once, instead of once
+	   per waiter that outranks us. */
+	thread_preempt_disable ();
+	while (!pheap_empty (&cond->waiters))
 		cond_signal (cond, lock);
+	thread_preempt_enable ();
 }
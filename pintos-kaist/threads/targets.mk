@@ -5,5 +5,8 @@ threads_SRC += threads/intr-stubs.S	# Interrupt stubs.
 threads_SRC += threads/synch.c		# Synchronization.
 threads_SRC += threads/palloc.c		# Page allocator.
 threads_SRC += threads/malloc.c		# Subpage allocator.
+threads_SRC += threads/slab.c		# Object caches.
+threads_SRC += threads/trace.c		# Scheduler tracing.
+threads_SRC += threads/workqueue.c	# Deferred work.
 threads_SRC += threads/start.S		# Startup code.
 threads_SRC += threads/mmu.c		    # Memory management unit related things.
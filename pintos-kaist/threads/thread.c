@@ -2,14 +2,20 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <rusage.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -24,14 +30,45 @@
 #define THREAD_BASIC 0xd42df210
 
 
-/* THREAD_READY 상태의 프로세스 리스트. 즉, 실행 준비는 되었지만 아직 실행되지 않은 프로세스들. */
-static struct list ready_list;
-
-/*thread_sleep()을 통해 block된 thread들. wakeup을 통해 ready_list로 이동*/
-static struct list sleep_list;
-
-/* Idle thread. */
-static struct thread *idle_thread;
+/* CPU마다 하나씩 있는 스케줄러 상태.
+   ready_queue는 THREAD_READY 상태의 프로세스 큐. 즉, 실행 준비는 되었지만 아직
+   실행되지 않은 프로세스들. 우선순위마다 FIFO 리스트를 하나씩 두고, ready_mask의
+   P번째 비트는 ready_queue[P]가 비어있지 않을 때만 켜진다. 삽입, 삭제, 최고
+   우선순위 조회가 모두 O(1)이다. 큐는 lock으로 보호되며, 다른 CPU가 work
+   stealing을 위해 잡을 수 있다. 지금은 AP를 깨우지 않아 NCPU가 1이므로
+   lock은 인터럽트 차단 이상의 일을 하지 않고, work stealing은 NCPU > 1일
+   때만 컴파일된다. */
+struct cpu {
+	int id;                              /* cpus[] 인덱스. */
+	struct spinlock lock;                /* ready_queue 보호. */
+	struct list ready_queue[PRI_MAX + 1];
+	uint64_t ready_mask;
+	struct pheap dl_queue;               /* READY인 deadline 쓰레드, 마감이 이른 순. */
+	int ready_cnt;                       /* ready_queue와 dl_queue에 있는 쓰레드 수. */
+	struct thread *curr;                 /* 이 CPU에서 실행 중인 쓰레드. */
+	struct thread *idle_thread;          /* 이 CPU의 idle 쓰레드. */
+	struct thread *fpu_owner;            /* FPU 레지스터에 상태가 올라가 있는 쓰레드. */
+	unsigned thread_ticks;               /* 마지막 yield 이후 경과된 timer tick 수 */
+};
+
+static struct cpu cpus[NCPU];
+
+/* 현재 CPU. 쓰레드의 cpu 필드는 schedule()에서 쓰레드가 올라갈 때 갱신되므로
+   쓰레드 스택 위에서 실행되는 한 어느 CPU에서든 올바르다. */
+#define this_cpu() (running_thread ()->cpu)
+
+/* T가 어떤 CPU의 idle 쓰레드인가? */
+#define is_idle_thread(t) ((t)->cpu != NULL && (t) == (t)->cpu->idle_thread)
+
+/* 살아있는 모든 쓰레드 리스트. mlfqs의 1초 주기 재계산에만 쓰인다. */
+static struct list all_list;
+
+/* 마지막 우선순위 재계산 이후 recent_cpu가 바뀐 쓰레드들.
+   4틱마다 이 쓰레드들의 우선순위만 다시 계산한다. */
+static struct list mlfqs_dirty_list;
+
+/* 시스템 load average (17.14 fixed-point). */
+static fixed_t load_avg;
 
 /* 초기 스레드. 즉, init.c의 main()을 실행하는 스레드. */
 static struct thread *initial_thread;
@@ -39,9 +76,55 @@ static struct thread *initial_thread;
 /* allocate_tid()에서 사용하는 락. */
 static struct lock tid_lock;
 
+/* Lazy FPU 전환.
+   스위치할 때마다 CR0.TS를 켜두고, 쓰레드가 실제로 FPU/SSE 명령을 쓰면 #NM
+   트랩에서 이전 소유자의 상태를 저장하고 자신의 상태를 복원한다. FPU를 쓰지
+   않는 쓰레드는 fpu_area를 할당받지 않고 저장/복원 비용도 없다. */
+#define CR0_MP (1 << 1)         /* Monitor coprocessor. */
+#define CR0_EM (1 << 2)         /* x87 emulation. */
+#define CR0_TS (1 << 3)         /* Task switched. */
+#define CR4_OSFXSR (1 << 9)     /* FXSAVE/FXRSTOR and SSE enabled. */
+#define CR4_OSXMMEXCPT (1 << 10)/* Unmasked SSE exceptions via #XF. */
+
+#define FPU_AREA_SIZE 512
+#define fpu_image(AREA) ((void *) ROUND_UP ((uintptr_t) (AREA), 16))
+
+/* fninit 직후의 깨끗한 FPU 상태. 처음 FPU를 쓰는 쓰레드는 이 상태에서 시작한다. */
+static uint8_t fpu_initial[FPU_AREA_SIZE] __attribute__ ((aligned (16)));
+
 /* 삭제 요청된 스레드 목록 */
 static struct list destruction_req;
 
+/* 쓰레드 페이지(struct thread + 커널 스택) 캐시. 죽은 쓰레드의 페이지를
+   memset 없이 다음 thread_create()에 바로 돌려준다. fork/exec/exit가
+   몰릴 때 palloc의 bitmap 탐색과 페이지 전체 초기화를 피한다. */
+#define THREAD_CACHE_RESERVE 32
+static struct slab_cache thread_cache;
+
+/* wait을 위한 child_status 캐시. */
+struct slab_cache child_status_cache;
+
+/* Deadline 스케줄링 클래스.
+   dl_runtime > 0인 쓰레드는 매 dl_period마다 dl_runtime 틱의 CPU를
+   dl_deadline 안에 보장받는다. 예산이 남은 deadline 쓰레드는 우선순위와
+   무관하게 일반 쓰레드보다 먼저, 마감(dl_abs_deadline)이 이른 순서(EDF)로
+   실행된다. 예산을 다 쓰면 다음 주기까지 일반 우선순위로 돌아간다(CBS
+   throttling). 모든 deadline 쓰레드의 runtime/period 합은 DL_BW_LIMIT를
+   넘을 수 없다(admission control). */
+#define DL_BW_SHIFT 20                    /* 대역폭 fixed-point 소수 비트 수. */
+#define DL_BW_LIMIT ((95LL << DL_BW_SHIFT) / 100 * NCPU)
+
+/* runtime, deadline, period의 상한(틱). RUNTIME << DL_BW_SHIFT와
+   thread_unblock()의 CBS 검사에서 두 값을 곱할 때 int64_t가 넘치지
+   않도록 2^31보다 작게 제한한다. 100Hz에서 8개월이 넘는다. */
+#define DL_TICKS_MAX INT32_MAX
+
+/* 예산이 남은 deadline 쓰레드의 ready_pri 값. */
+#define READY_DL (PRI_MIN - 1)
+
+/* 허가된 deadline 쓰레드들의 대역폭 합. 인터럽트를 꺼서 보호한다. */
+static int64_t dl_total_bw;
+
 /* 통계 정보. */
 static long long idle_ticks;   /* idle 상태로 소비된 timer tick 수 */
 static long long kernel_ticks; /* 커널 스레드에서 소비된 timer tick 수 */
@@ -49,7 +132,6 @@ static long long user_ticks;   /* 사용자 프로그램에서 소비된 timer t
 
 /* 스케줄링 */
 #define TIME_SLICE 4		  /* 각 스레드에 할당할 timer tick 수 */
-static unsigned thread_ticks; /* 마지막 yield 이후 경과된 timer tick 수 */
 
 /* false가 기본값이면 round-robin 스케줄러 사용.
    true면 multi-level feedback queue 스케줄러 사용.
@@ -57,6 +139,7 @@ static unsigned thread_ticks; /* 마지막 yield 이후 경과된 timer tick 수
 bool thread_mlfqs;
 
 static void kernel_thread (thread_func *, void *aux);
+static void thread_wakeup (struct timeout *, void *t);
 
 static void idle (void *aux UNUSED);
 static struct thread *next_thread_to_run (void);
@@ -64,6 +147,30 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static void ready_push (struct cpu *, struct thread *);
+static struct thread *ready_pop (struct cpu *);
+#if NCPU > 1
+static struct thread *ready_steal (struct cpu *);
+#endif
+static int ready_max_priority (struct cpu *);
+static int ready_threads_total (void);
+static void fpu_init (void);
+static void *fpu_area_alloc (const void *image);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_mark_dirty (struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static void mlfqs_update_recent_cpu (struct thread *, fixed_t coef);
+static void acct_charge (struct thread *, uint64_t now);
+static void ready_requeue (struct thread *);
+static void ready_enqueue (struct cpu *, struct thread *);
+static void ready_dequeue (struct thread *);
+static bool dl_runnable (const struct thread *);
+static bool dl_earlier (const struct pheap_elem *, const struct pheap_elem *, void *);
+static struct thread *dl_pop (struct cpu *);
+static bool dl_should_preempt (struct cpu *);
+static void preempt_current (void);
+static void dl_leave (struct thread *);
+static void dl_replenish (struct timeout *, void *t);
 
 /* Returns true if T appears to point to a valid thread. */
 // 현재 구조체가 쓰레드인지 확인
@@ -112,16 +219,36 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);			// cpu 자원 쓰는 것을 선점하고 관리하기 위한 lock
-	list_init (&ready_list);
+	for (int c = 0; c < NCPU; c++) {
+		struct cpu *cpu = &cpus[c];
+		cpu->id = c;
+		spin_init (&cpu->lock);
+		for (int i = PRI_MIN; i <= PRI_MAX; i++)
+			list_init (&cpu->ready_queue[i]);
+		cpu->ready_mask = 0;
+		pheap_init (&cpu->dl_queue);
+		cpu->ready_cnt = 0;
+		cpu->curr = NULL;
+		cpu->idle_thread = NULL;
+		cpu->fpu_owner = NULL;
+		cpu->thread_ticks = 0;
+	}
+	list_init (&all_list);
+	list_init (&mlfqs_dirty_list);
+	load_avg = 0;
 	list_init (&destruction_req);	//쓰레드 폐기 요청 리스트
-	list_init (&sleep_list);
-	
-	global_tick = INT64_MAX; // global tick init - ch
+	slab_cache_init (&thread_cache, "thread", PGSIZE, THREAD_CACHE_RESERVE);
+	slab_cache_init (&child_status_cache, "child_status",
+			sizeof (struct child_status), 16);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
+	initial_thread->cpu = &cpus[0];
+	cpus[0].curr = initial_thread;
+
+	fpu_init ();
 	initial_thread->tid = allocate_tid ();
 }
 
@@ -150,7 +277,7 @@ thread_tick (void) {
 	struct thread *t = thread_current ();
 
 	/* Update statistics. */
-	if (t == idle_thread)
+	if (is_idle_thread (t))
 		idle_ticks++;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
@@ -159,9 +286,24 @@ thread_tick (void) {
 	else
 		kernel_ticks++;
 
-	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
-		intr_yield_on_return ();
+	if (thread_mlfqs)
+		mlfqs_tick (t);
+
+	/* Deadline 쓰레드의 예산을 깎고, 다 썼으면 다음 주기까지 throttle한다. */
+	if (dl_runnable (t) && --t->dl_budget <= 0) {
+		int64_t now = timer_ticks ();
+		t->dl_throttled = true;
+		timeout_arm (&t->dl_timer, t->dl_next_period > now ? t->dl_next_period : now + 1);
+		preempt_current ();
+	}
+	if (dl_should_preempt (this_cpu ()))
+		preempt_current ();
+
+	/* Enforce preemption.  idle 쓰레드는 다른 쓰레드가 ready가 되면 바로
+	   스스로 block하므로 time slice가 없다. tickless 모드에서는 idle 쓰레드가
+	   인터럽트 밖에서 밀린 틱을 처리하기도 한다. */
+	if (!is_idle_thread (t) && ++this_cpu ()->thread_ticks >= TIME_SLICE)
+		preempt_current ();
 }
 
 /* Prints thread statistics. */
@@ -197,29 +339,21 @@ thread_create (const char *name, int priority,
 
 	ASSERT (function != NULL);
 
-	/* 스레드를 할당한다. */
-	t = palloc_get_page (PAL_ZERO);
+	/* 스레드를 할당한다. 재사용된 페이지는 지워져 있지 않지만
+	   init_thread()가 struct thread를 초기화하고, 나머지는 스택이다. */
+	t = slab_alloc (&thread_cache);
 	if (t == NULL)
 		return TID_ERROR;
+	struct child_status *cs = slab_alloc (&child_status_cache);
+	if (cs == NULL) {
+		slab_free (&thread_cache, t);
+		return TID_ERROR;
+	}
 
 	/* 스레드를 초기화한다. */
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();	// 스레드 id
 	
-	/*------------------[Project2 - file]------------------*/
-	for(int i = 0; i<64 ; i++){
-		t->fdt[i] = NULL;
-	}
-	t->fdt[0] = 0;
-	t->fdt[1] = 1;
-	t->next_fd = 2;
-
-	/*------------------[Project2 - file]------------------*/
-	struct child_status *cs = palloc_get_page(PAL_ZERO);
-	if (cs == NULL) {
-		palloc_free_page(t);  // t도 해제 필요
-		return TID_ERROR;
-	}
 	cs->tid = t->tid;
 	cs->exit_status = 0;
 	cs->has_been_waited = false;
@@ -243,10 +377,9 @@ thread_create (const char *name, int priority,
 	/* ready 큐에 추가한다. */
 	thread_unblock (t);
 	/* 현재 실행 중인 스레드와 새로 삽입된 스레드의 우선순위(priority)를 비교한다.
-	   새로 도착한 스레드의 우선순위가 더 높다면 CPU를 양보(yield)한다.*/
-	if(thread_current()->priority < priority){
-		thread_yield();
-	}
+	   새로 도착한 스레드의 우선순위가 더 높다면 CPU를 양보(yield)한다.
+	   mlfqs에서는 PRIORITY 대신 계산된 우선순위를 쓴다.*/
+	thread_preempt_check (t);
 	return tid;
 }
 
@@ -273,7 +406,7 @@ thread_block (void) {
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
    update other data. */
-// 인터럽트를 비활성화하고 블록되어있는 쓰레드를 ready_list에 추가한다.
+// 인터럽트를 비활성화하고 블록되어있는 쓰레드를 ready_queue에 추가한다.
 void
 thread_unblock (struct thread *t) {
 	enum intr_level old_level;
@@ -282,11 +415,85 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_insert_ordered(&ready_list, &t->elem, priority_more, NULL);
+	if (dl_runnable (t)) {
+		/* CBS wakeup rule: 남은 예산을 남은 시간 안에 다 쓰면 보장된
+		   대역폭을 넘게 되는 경우 새 마감과 예산으로 시작한다. */
+		int64_t now = timer_ticks ();
+		if (t->dl_abs_deadline <= now
+				|| t->dl_budget * t->dl_deadline > (t->dl_abs_deadline - now) * t->dl_runtime) {
+			t->dl_abs_deadline = now + t->dl_deadline;
+			t->dl_next_period = now + t->dl_period;
+			t->dl_budget = t->dl_runtime;
+		}
+	}
+	ready_push (this_cpu (), t);
 	t->status = THREAD_READY;
+	trace_wakeup (t);
+	if (intr_context () && dl_should_preempt (this_cpu ()))
+		intr_yield_on_return ();
 	intr_set_level (old_level);
 }
 
+/* 방금 ready가 된 T가 현재 쓰레드보다 먼저 실행되어야 하면 CPU를 양보한다.
+   예산이 남은 deadline 쓰레드는 우선순위와 관계없이 일반 쓰레드보다 먼저이고,
+   deadline 쓰레드끼리는 마감이 이른 쪽이 먼저다. 현재 쓰레드가 예산이 남은
+   deadline 쓰레드라면 일반 쓰레드에게는 양보하지 않는다. 인터럽트 핸들러 안이라면 핸들러가 끝날 때 양보하고, 현재 쓰레드가
+   thread_preempt_disable() 구간 안에 있다면 thread_preempt_enable()에서
+   한 번만 양보한다. 그래서 여러 쓰레드를 한꺼번에 깨워도 문맥 전환은
+   한 번이다. */
+void
+thread_preempt_check (struct thread *t) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	bool preempt;
+
+	old_level = intr_disable ();
+	preempt = dl_should_preempt (this_cpu ())
+		|| (!dl_runnable (curr) && !dl_runnable (t)
+			&& curr->priority < t->priority);
+	intr_set_level (old_level);
+
+	if (preempt)
+		preempt_current ();
+}
+
+/* 현재 쓰레드가 CPU를 양보하게 한다. 인터럽트 핸들러 안이라면 핸들러가
+   끝날 때, thread_preempt_disable() 구간 안이라면 thread_preempt_enable()에서
+   양보한다. tickless 모드에서는 thread_tick()과 타이머 휠 콜백이 idle
+   쓰레드에서 인터럽트 밖으로 불리므로 intr_yield_on_return()을 바로 쓸 수
+   없다. idle 쓰레드는 thread_yield()가 무시하지만 곧 스스로 block한다. */
+static void
+preempt_current (void) {
+	struct thread *curr = thread_current ();
+
+	if (intr_context ())
+		intr_yield_on_return ();
+	else if (curr->preempt_count > 0)
+		curr->need_resched = true;
+	else
+		thread_yield ();
+}
+
+/* thread_preempt_check()로 인한 양보를 thread_preempt_enable()까지
+   미룬다. 중첩할 수 있다. block하는 것은 막지 않는다. */
+void
+thread_preempt_disable (void) {
+	thread_current ()->preempt_count++;
+}
+
+/* thread_preempt_disable()을 끝낸다. 가장 바깥 구간이 끝날 때 그 사이에
+   미뤄둔 양보가 있었다면 한 번 양보한다. */
+void
+thread_preempt_enable (void) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (curr->preempt_count > 0);
+	if (--curr->preempt_count == 0 && curr->need_resched) {
+		curr->need_resched = false;
+		thread_yield ();
+	}
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void) {
@@ -312,6 +519,69 @@ thread_current (void) {
 	return t;
 }
 
+/* T가 지금 다른 CPU에서 실행 중인가? adaptive lock이 holder를 기다리며
+   spin할지 판단하는 데 쓴다. 잠금 없이 읽으므로 힌트일 뿐이다. */
+#if NCPU > 1
+bool
+thread_running_elsewhere (const struct thread *t) {
+	struct cpu *cpu = t->cpu;
+
+	return cpu != NULL && cpu != this_cpu () && cpu->curr == t
+		&& t->status == THREAD_RUNNING;
+}
+#endif
+
+/* 현재 CPU의 번호. */
+int
+thread_cpu_id (void) {
+	return this_cpu ()->id;
+}
+
+/* 현재 쓰레드가 user 모드(USER가 true)나 커널 모드로 들어간다.
+   syscall 진입과 복귀, 프로세스 시작 때 호출한다. 지금까지의 시간은
+   이전 모드에 더해진다. */
+void
+thread_acct_mode (bool user) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = intr_disable ();
+
+	acct_charge (curr, rdtsc ());
+	curr->acct_user = user;
+	intr_set_level (old_level);
+}
+
+/* 현재 쓰레드의 CPU 사용량을 USAGE에 채운다. */
+void
+thread_get_rusage (struct rusage *usage) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = intr_disable ();
+
+	acct_charge (curr, rdtsc ());
+	usage->user_cycles = curr->user_cycles;
+	usage->kernel_cycles = curr->kernel_cycles;
+	usage->vol_switches = curr->vol_switches;
+	usage->invol_switches = curr->invol_switches;
+	intr_set_level (old_level);
+}
+
+/* CPU 사용 시간 계산.
+   tick 단위로 세면 한 tick보다 짧게 도는 프로세스는 0으로 잡히고, 타이머
+   인터럽트 순간에 누가 돌았느냐에 따라 치우친다. 대신 쓰레드가 CPU를
+   잡은 구간을 TSC로 재서 현재 모드(user/kernel)에 더한다. 구간은
+   schedule()의 쓰레드 전환과 syscall 진입/복귀에서 끊는다. syscall이 아닌
+   인터럽트로 커널에 들어온 시간은 user 시간으로 잡힌다.
+   인터럽트가 꺼진 상태에서 호출해야 한다. */
+static void
+acct_charge (struct thread *t, uint64_t now) {
+	uint64_t delta = now - t->acct_tsc;
+
+	if (t->acct_user)
+		t->user_cycles += delta;
+	else
+		t->kernel_cycles += delta;
+	t->acct_tsc = now;
+}
+
 /* Returns the running thread's tid. */
 // 현재 쓰레드 tid반환
 tid_t
@@ -328,20 +598,25 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
+	thread_fpu_release ();
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	dl_leave (thread_current ());
+	list_remove (&thread_current ()->all_elem);
+	if (thread_current ()->mlfqs_dirty)
+		list_remove (&thread_current ()->mlfqs_elem);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
 
 /* Yields the CPU.  The current thread is not put to sleep and
    may be scheduled again immediately at the scheduler's whim. */
-// 현재실행중인 쓰레드를 준비상태로 ready_list의 마지막에 넣는다.
+// 현재실행중인 쓰레드를 준비상태로 같은 우선순위 큐의 마지막에 넣는다.
 void
 thread_yield (void) {
-	if(thread_current() != idle_thread)
+	if(!is_idle_thread (thread_current ()))
 	{
 		struct thread *curr = thread_current ();
 		enum intr_level old_level;
@@ -349,15 +624,14 @@ thread_yield (void) {
 		ASSERT (!intr_context ());
 
 		old_level = intr_disable ();
-		if (curr != idle_thread)
-			list_insert_ordered(&ready_list, &curr->elem, priority_more, NULL);
+		ready_push (this_cpu (), curr);
 		do_schedule (THREAD_READY);
 		intr_set_level (old_level);
 	}
 }
 
-// 현재 쓰레드를 블록하고  sleep_list로 이동시킨다.
-// list_insert_ordered()를 통해 sleep_list 내부를 getuptick순으로 정렬한다.
+// 현재 쓰레드를 블록하고 GETUPTICK에 깨어나도록 타이머 휠에 sleep_timeout을 건다.
+// 휠에 거는 비용은 잠든 쓰레드 수와 무관하게 O(1)이다.
 void thread_sleep(int64_t getuptick)
 {
 	struct thread *curr = thread_current();
@@ -366,85 +640,203 @@ void thread_sleep(int64_t getuptick)
 	ASSERT(!intr_context());
 
 	old_level = intr_disable();
-	if (curr != idle_thread) // 현재 쓰레드가 idle_thread가 아니라면
+	if (!is_idle_thread (curr)) // 현재 쓰레드가 idle_thread가 아니라면
 	{
-		curr->getuptick = getuptick; // 깨어날 시간을 getupick으로 저장
-		list_insert_ordered(&sleep_list, &curr->elem, getuptick_less, NULL);
-		struct thread *target = list_entry(list_begin(&sleep_list), struct thread, elem); // 리스트에 정렬 삽입
-		global_tick = target->getuptick;
+		timeout_arm (&curr->sleep_timeout, getuptick);
 		thread_block();
 	}
 	intr_set_level(old_level); // 인터럽트 수준을 원래 상태로 설정한다.
 }
 
-// sleep_list에서 가장 현재 global_tick과 깨어날 시간이 같은 쓰레드를 ready_list로 이동시킨다.
-void wakeup(void)
+// sleep_timeout 콜백. timer interrupt 안에서 잠든 쓰레드 T를 ready_queue로 옮긴다.
+static void
+thread_wakeup (struct timeout *to UNUSED, void *t)
 {
-	if (list_empty(&sleep_list)){
-		return;
-	}
+	thread_unblock (t);
+}
+
+// priority compare helper function
+bool priority_more(const struct list_elem *a_, const struct list_elem *b_,
+					void *aux UNUSED)
+{
+	const struct thread *a = list_entry(a_, struct thread, elem);
+	const struct thread *b = list_entry(b_, struct thread, elem);
 
+	return a->priority > b->priority;
+}
+
+// 우선순위가 바뀐 쓰레드 T가 ready_queue에 있다면 새 우선순위의 큐 끝으로 옮기고,
+// semaphore나 condition을 기다리며 BLOCKED라면 waiter heap 안의 위치를 고친다.
+// donation처럼 다른 쓰레드의 우선순위를 직접 바꾸는 곳에서 호출해야 한다.
+void
+thread_reposition_ready (struct thread *t) {
 	enum intr_level old_level;
 
-	old_level = intr_disable(); // 인터럽트 비활성화
+	ASSERT (is_thread (t));
 
-	struct list_elem *start = list_begin(&sleep_list);
+	old_level = intr_disable ();
+	if (t->status == THREAD_READY && t->ready_pri != READY_DL
+			&& t->ready_pri != t->priority) {
+		ready_requeue (t);
+	} else if (t->status == THREAD_BLOCKED)
+		waiter_reposition (t);
+	intr_set_level (old_level);
+}
 
-	while (start != list_end(&sleep_list))
-	{
-		struct thread *start_thread = list_entry(start, struct thread, elem);
-		if (start_thread->getuptick <= global_tick)
-		{
-			struct list_elem *next = start->next;
-			list_pop_front(&sleep_list);
-			thread_unblock(start_thread);
-			start = next;
-		}
-		else
-		{
-			break;
-		}
+// T를 CPU의 우선순위 큐 끝에 넣고 occupancy 비트를 켠다. 예산이 남은
+// deadline 쓰레드는 대신 dl_queue에 넣는다. 인터럽트는 꺼져 있어야 한다.
+static void
+ready_push (struct cpu *cpu, struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&cpu->lock);
+	ready_enqueue (cpu, t);
+	spin_unlock (&cpu->lock);
+}
+
+// READY인 T를 큐에서 빼서 현재 priority와 deadline 상태에 맞는 큐 끝에 다시
+// 넣는다. 두 단계를 한 번의 lock 안에서 하므로 다른 CPU가 그 사이에 T를
+// 볼 수 없다. 인터럽트는 꺼져 있어야 한다.
+static void
+ready_requeue (struct thread *t) {
+	struct cpu *cpu = t->cpu;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&cpu->lock);
+	ready_dequeue (t);
+	ready_enqueue (cpu, t);
+	spin_unlock (&cpu->lock);
+}
+
+// ready_push()의 본체. CPU의 lock을 잡고 있어야 한다.
+static void
+ready_enqueue (struct cpu *cpu, struct thread *t) {
+	ASSERT (spin_held_by_current_thread (&cpu->lock));
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	t->cpu = cpu;
+	if (dl_runnable (t)) {
+		t->ready_pri = READY_DL;
+		pheap_push (&cpu->dl_queue, &t->dl_elem, dl_earlier, NULL);
+	} else {
+		t->ready_pri = t->priority;
+		list_push_back (&cpu->ready_queue[t->ready_pri], &t->elem);
+		cpu->ready_mask |= 1ULL << t->ready_pri;
 	}
+	cpu->ready_cnt++;
+}
 
-	if (!list_empty(&sleep_list))
-	{
-		global_tick = list_entry(start, struct thread, elem)->getuptick; // 현재 쓰레드에 저장된 값을 변경
+// READY인 T를 들어있는 큐에서 뺀다. T가 들어있는 CPU의 lock을 잡고 있어야
+// 한다.
+static void
+ready_dequeue (struct thread *t) {
+	struct cpu *cpu = t->cpu;
+
+	ASSERT (spin_held_by_current_thread (&cpu->lock));
+	ASSERT (t->status == THREAD_READY);
+
+	if (t->ready_pri == READY_DL)
+		pheap_remove (&cpu->dl_queue, &t->dl_elem, dl_earlier, NULL);
+	else {
+		list_remove (&t->elem);
+		if (list_empty (&cpu->ready_queue[t->ready_pri]))
+			cpu->ready_mask &= ~(1ULL << t->ready_pri);
 	}
-	else
-	{
-		global_tick = INT64_MAX;
+	cpu->ready_cnt--;
+}
+
+// CPU의 가장 높은 우선순위 큐의 맨 앞 쓰레드를 꺼낸다. 비어있으면 NULL.
+static struct thread *
+ready_pop (struct cpu *cpu) {
+	struct thread *t = NULL;
+	int pri;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&cpu->lock);
+	pri = ready_max_priority (cpu);
+	if (pri >= PRI_MIN) {
+		t = list_entry (list_pop_front (&cpu->ready_queue[pri]), struct thread, elem);
+		if (list_empty (&cpu->ready_queue[pri]))
+			cpu->ready_mask &= ~(1ULL << pri);
+		cpu->ready_cnt--;
 	}
+	spin_unlock (&cpu->lock);
+	return t;
+}
 
-	intr_set_level(old_level); // 인터럽트 수준을 원래 상태로 설정한다.
+// CPU의 dl_queue에서 마감이 가장 이른 쓰레드를 꺼낸다. 비어있으면 NULL.
+static struct thread *
+dl_pop (struct cpu *cpu) {
+	struct thread *t = NULL;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&cpu->lock);
+	if (!pheap_empty (&cpu->dl_queue)) {
+		t = pheap_entry (pheap_pop (&cpu->dl_queue, dl_earlier, NULL),
+				struct thread, dl_elem);
+		cpu->ready_cnt--;
+	}
+	spin_unlock (&cpu->lock);
+	return t;
 }
 
-// getuptick순으로 정렬하는 내부함수
-bool getuptick_less(const struct list_elem *a_, const struct list_elem *b_,
-					void *aux UNUSED)
-{
-	const struct thread *a = list_entry(a_, struct thread, elem);
-	const struct thread *b = list_entry(b_, struct thread, elem);
+#if NCPU > 1
+// SELF의 큐가 비었을 때 가장 많은 쓰레드가 대기 중인 다른 CPU에서 하나를 훔쳐온다.
+// ready_cnt는 잠금 없이 읽으므로 힌트일 뿐이고, 실제 pop은 그 CPU의 lock 아래에서 한다.
+// ready_cnt에는 dl_queue의 쓰레드도 포함되므로, 로컬 선택과 같은 순서로
+// deadline 쓰레드를 먼저 가져온다.
+static struct thread *
+ready_steal (struct cpu *self) {
+	struct cpu *busiest = NULL;
+	struct thread *t;
 
-	return a->getuptick < b->getuptick;
+	for (int c = 0; c < NCPU; c++) {
+		struct cpu *cpu = &cpus[c];
+		if (cpu != self && cpu->ready_cnt > 0
+				&& (busiest == NULL || cpu->ready_cnt > busiest->ready_cnt))
+			busiest = cpu;
+	}
+	if (busiest == NULL)
+		return NULL;
+	t = dl_pop (busiest);
+	return t != NULL ? t : ready_pop (busiest);
 }
+#endif
 
-// priority compare helper function
-bool priority_more(const struct list_elem *a_, const struct list_elem *b_,
-					void *aux UNUSED)
-{
-	const struct thread *a = list_entry(a_, struct thread, elem);
-	const struct thread *b = list_entry(b_, struct thread, elem);
+// CPU의 ready_queue에 있는 쓰레드 중 가장 높은 우선순위. 비어있으면 PRI_MIN - 1.
+static int
+ready_max_priority (struct cpu *cpu) {
+	uint64_t mask = cpu->ready_mask;
 
-	return a->priority > b->priority;
+	if (mask == 0)
+		return PRI_MIN - 1;
+	return 63 - __builtin_clzll (mask);
+}
+
+// 모든 CPU의 ready_queue에 있는 쓰레드 수.
+static int
+ready_threads_total (void) {
+	int cnt = 0;
+
+	for (int c = 0; c < NCPU; c++)
+		cnt += cpus[c].ready_cnt;
+	return cnt;
 }
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void
 thread_set_priority (int new_priority) {
+	/* mlfqs에서는 우선순위를 스케줄러가 직접 계산한다. */
+	if (thread_mlfqs)
+		return;
+
 	thread_current()->origin_priority = new_priority;
 	refresh_priority();
 
-	if (thread_get_priority() < list_entry(list_begin(&ready_list), struct thread, elem)->priority)
+	if (thread_get_priority() < ready_max_priority (this_cpu ()))
 	{
 		thread_yield();	
 	}
@@ -458,29 +850,237 @@ thread_get_priority (void) {
 
 /* Sets the current thread's nice value to NICE. */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
+thread_set_nice (int nice) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+	old_level = intr_disable ();
+	curr->nice = nice;
+	if (thread_mlfqs)
+		mlfqs_update_priority (curr);
+	intr_set_level (old_level);
+
+	if (curr->priority < ready_max_priority (this_cpu ()))
+		thread_yield ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int load = fp_to_int_round (fp_mul_int (load_avg, 100));
+	intr_set_level (old_level);
+	return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int recent = fp_to_int_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+	intr_set_level (old_level);
+	return recent;
+}
+
+/* 현재 쓰레드를 deadline 클래스에 넣는다. 매 PERIOD 틱마다 RUNTIME 틱을
+   주기 시작 후 DEADLINE 틱 안에 보장받는다.
+   0 < RUNTIME <= DEADLINE <= PERIOD <= DL_TICKS_MAX여야 한다.
+   RUNTIME이 0이면 클래스에서 나온다. 값이 잘못되었거나 허가하면 전체
+   대역폭이 DL_BW_LIMIT를 넘는 경우 false를 반환하고 아무것도 바꾸지 않는다. */
+bool
+thread_set_deadline (int64_t runtime, int64_t period, int64_t deadline) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	int64_t bw;
+
+	if (runtime == 0) {
+		old_level = intr_disable ();
+		dl_leave (curr);
+		intr_set_level (old_level);
+		thread_yield ();
+		return true;
+	}
+	if (runtime < 0 || runtime > deadline || deadline > period
+			|| period > DL_TICKS_MAX)
+		return false;
+
+	bw = (runtime << DL_BW_SHIFT) / period;
+	old_level = intr_disable ();
+	if (dl_total_bw - curr->dl_bw + bw > DL_BW_LIMIT) {
+		intr_set_level (old_level);
+		return false;
+	}
+	dl_total_bw += bw - curr->dl_bw;
+	curr->dl_bw = bw;
+	curr->dl_runtime = runtime;
+	curr->dl_deadline = deadline;
+	curr->dl_period = period;
+	curr->dl_abs_deadline = timer_ticks () + deadline;
+	curr->dl_next_period = timer_ticks () + period;
+	curr->dl_budget = runtime;
+	curr->dl_throttled = false;
+	timeout_cancel (&curr->dl_timer);
+	intr_set_level (old_level);
+	return true;
+}
+
+/* T가 deadline 클래스이고 이번 주기 예산이 남아 있는가? */
+static bool
+dl_runnable (const struct thread *t) {
+	return t->dl_runtime > 0 && !t->dl_throttled;
+}
+
+/* dl_queue 순서: 마감이 이른 쓰레드가 먼저. */
+static bool
+dl_earlier (const struct pheap_elem *a_, const struct pheap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = pheap_entry (a_, struct thread, dl_elem);
+	const struct thread *b = pheap_entry (b_, struct thread, dl_elem);
+
+	return a->dl_abs_deadline < b->dl_abs_deadline;
+}
+
+/* CPU의 dl_queue 맨 앞 쓰레드가 지금 실행 중인 쓰레드를 선점해야 하는가? */
+static bool
+dl_should_preempt (struct cpu *cpu) {
+	struct pheap_elem *top = pheap_top (&cpu->dl_queue);
+	struct thread *curr = cpu->curr;
+
+	if (top == NULL)
+		return false;
+	return !dl_runnable (curr)
+		|| pheap_entry (top, struct thread, dl_elem)->dl_abs_deadline
+			< curr->dl_abs_deadline;
+}
+
+/* T를 deadline 클래스에서 빼고 대역폭을 돌려준다. T는 실행 중이어야
+   하고 인터럽트는 꺼져 있어야 한다. */
+static void
+dl_leave (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_RUNNING);
+
+	timeout_cancel (&t->dl_timer);
+	dl_total_bw -= t->dl_bw;
+	t->dl_bw = 0;
+	t->dl_runtime = 0;
+	t->dl_throttled = false;
+}
+
+/* Throttle된 deadline 쓰레드 T에게 새 주기의 예산과 마감을 준다.
+   타이머 인터럽트에서 호출된다. */
+static void
+dl_replenish (struct timeout *to UNUSED, void *t_) {
+	struct thread *t = t_;
+	int64_t now = timer_ticks ();
+
+	if (t->dl_next_period < now)
+		t->dl_next_period = now;
+	t->dl_abs_deadline = t->dl_next_period + t->dl_deadline;
+	t->dl_next_period += t->dl_period;
+	t->dl_budget = t->dl_runtime;
+
+	/* 일반 ready 큐에서 기다리고 있었다면 dl_queue로 옮긴다. */
+	if (t->status == THREAD_READY) {
+		t->dl_throttled = false;
+		ready_requeue (t);
+	} else
+		t->dl_throttled = false;
+	if (dl_should_preempt (this_cpu ()))
+		preempt_current ();
+}
+
+/* mlfqs 틱 처리. timer interrupt 안에서 호출되므로 짧게 끝나야 한다.
+   매 틱에는 실행 중인 쓰레드의 recent_cpu만 올리고, 4틱마다 그 사이에
+   recent_cpu가 바뀐 쓰레드의 우선순위만 다시 계산한다. load_avg가 바뀌는
+   1초 주기에만 모든 쓰레드를 순회한다. */
+static void
+mlfqs_tick (struct thread *t) {
+	int64_t now = timer_ticks ();
+
+	if (!is_idle_thread (t)) {
+		t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+		mlfqs_mark_dirty (t);
+	}
+
+	if (now % TIMER_FREQ == 0) {
+		int ready_threads = ready_threads_total ();
+		fixed_t twice_load;
+		fixed_t coef;
+		struct list_elem *e;
+
+		/* 실행 중인 쓰레드도 ready_threads에 포함된다. */
+		for (int c = 0; c < NCPU; c++)
+			if (cpus[c].curr != NULL && !is_idle_thread (cpus[c].curr))
+				ready_threads++;
+
+		load_avg = fp_add (fp_div_int (fp_mul_int (load_avg, 59), 60),
+				fp_div_int (int_to_fp (ready_threads), 60));
+		twice_load = fp_mul_int (load_avg, 2);
+		coef = fp_div (twice_load, fp_add_int (twice_load, 1));
+
+		for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e)) {
+			struct thread *th = list_entry (e, struct thread, all_elem);
+			if (is_idle_thread (th))
+				continue;
+			mlfqs_update_recent_cpu (th, coef);
+			mlfqs_update_priority (th);
+		}
+
+		/* 방금 모두 다시 계산했으므로 dirty 목록은 비운다. */
+		while (!list_empty (&mlfqs_dirty_list))
+			list_entry (list_pop_front (&mlfqs_dirty_list),
+					struct thread, mlfqs_elem)->mlfqs_dirty = false;
+	} else if (now % TIME_SLICE == 0) {
+		while (!list_empty (&mlfqs_dirty_list)) {
+			struct thread *th = list_entry (list_pop_front (&mlfqs_dirty_list),
+					struct thread, mlfqs_elem);
+			th->mlfqs_dirty = false;
+			mlfqs_update_priority (th);
+		}
+	}
+
+	if (!is_idle_thread (t) && t->priority < ready_max_priority (this_cpu ()))
+		preempt_current ();
+}
+
+// T를 다음 4틱 재계산 대상에 올린다. 인터럽트는 꺼져 있어야 한다.
+static void
+mlfqs_mark_dirty (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!t->mlfqs_dirty) {
+		t->mlfqs_dirty = true;
+		list_push_back (&mlfqs_dirty_list, &t->mlfqs_elem);
+	}
+}
+
+// priority = PRI_MAX - (recent_cpu / 4) - (nice * 2), [PRI_MIN, PRI_MAX]로 자른다.
+static void
+mlfqs_update_priority (struct thread *t) {
+	int priority = PRI_MAX - fp_to_int (fp_div_int (t->recent_cpu, 4)) - t->nice * 2;
+
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	else if (priority > PRI_MAX)
+		priority = PRI_MAX;
+
+	t->priority = priority;
+	thread_reposition_ready (t);
+}
+
+// recent_cpu = (2*load_avg)/(2*load_avg + 1) * recent_cpu + nice.
+// COEF는 한 번 계산한 (2*load_avg)/(2*load_avg + 1)이다.
+static void
+mlfqs_update_recent_cpu (struct thread *t, fixed_t coef) {
+	t->recent_cpu = fp_add_int (fp_mul (coef, t->recent_cpu), t->nice);
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -496,14 +1096,18 @@ static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
+	this_cpu ()->idle_thread = thread_current ();
 	sema_up (idle_started);		// 유후 쓰레드이기 때문에 세마포어 한칸 늘려놓기
 
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
+		timer_idle_exit ();
 		thread_block ();
 
+		/* 곧 깨어날 일이 없다면 주기적 tick을 멈춘다. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -549,11 +1153,28 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->origin_priority = priority;
 	t->magic = THREAD_MAGIC;
 	/*------------------[Project1 - Thread]------------------*/
-	t->getuptick = 0;
-	list_init(&t->donations);
+	timeout_init (&t->sleep_timeout, thread_wakeup, t);
+	t->acct_tsc = rdtsc ();
+	timeout_init (&t->dl_timer, dl_replenish, t);
+	pheap_init(&t->held_locks);
 	t->wait_on_lock = NULL;
+	t->wait_on_rwlock = NULL;
 	list_init(&t->child);
 	sema_init(&t->fork_sema, 0);
+
+	/*------------------[Project1 - mlfqs]------------------*/
+	/* 새 쓰레드는 부모의 nice와 recent_cpu를 물려받는다.
+	   initial_thread는 아직 running_thread()가 자기 자신이므로 기본값을 쓴다. */
+	if (t != running_thread ()) {
+		t->nice = running_thread ()->nice;
+		t->recent_cpu = running_thread ()->recent_cpu;
+	}
+	if (thread_mlfqs)
+		mlfqs_update_priority (t);
+
+	enum intr_level old_level = intr_disable ();
+	list_push_back (&all_list, &t->all_elem);
+	intr_set_level (old_level);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
@@ -561,13 +1182,20 @@ init_thread (struct thread *t, const char *name, int priority) {
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
    idle_thread. */
-// ready_list가 비어있다면 idle_thread를 반환하고, 비어있지 않다면 다음 값을 pop해서 반환한다.
+// 이 CPU의 ready_queue에서 가장 높은 우선순위 쓰레드를 pop해서 반환한다.
+// 비어있다면 다른 CPU의 큐에서 훔쳐오고, 그래도 없으면 idle_thread를 반환한다.
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct cpu *cpu = this_cpu ();
+	struct thread *t = dl_pop (cpu);
+
+	if (t == NULL)
+		t = ready_pop (cpu);
+#if NCPU > 1
+	if (t == NULL)
+		t = ready_steal (cpu);
+#endif
+	return t != NULL ? t : cpu->idle_thread;
 }
 
 /* Use iretq to launch the thread */
@@ -682,17 +1310,18 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		slab_free (&thread_cache, victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
 }
 
-// ready_list의 다음 쓰레드를 실행하는 함수
+// ready_queue의 다음 쓰레드를 실행하는 함수
 static void
 schedule (void) {
 	struct thread *curr = running_thread ();
 	struct thread *next = next_thread_to_run ();
+	struct cpu *cpu = curr->cpu;
 
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
@@ -701,7 +1330,9 @@ schedule (void) {
 	next->status = THREAD_RUNNING;
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	next->cpu = cpu;
+	cpu->curr = next;
+	cpu->thread_ticks = 0;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -721,12 +1352,125 @@ schedule (void) {
 			list_push_back (&destruction_req, &curr->elem);
 		}
 
+		/* FPU 상태는 #NM 트랩에서 게으르게 옮긴다. 다음 쓰레드가 이미
+		   FPU 소유자라면 트랩 없이 바로 쓰게 한다. */
+		if (next == cpu->fpu_owner)
+			clts ();
+		else
+			lcr0 (rcr0 () | CR0_TS);
+
+		uint64_t now = rdtsc ();
+		acct_charge (curr, now);
+		next->acct_tsc = now;
+		if (curr->status == THREAD_READY)
+			curr->invol_switches++;
+		else if (curr->status == THREAD_BLOCKED)
+			curr->vol_switches++;
+
+		trace_switch (curr, next);
+
 		/* Before switching the thread, we first save the information
 		 * of current running. */
 		thread_launch (next);
 	}
 }
 
+// SSE를 켜고 깨끗한 FPU 상태를 fpu_initial에 저장해둔다. CR0.TS를 켜서 첫 사용을 트랩한다.
+static void
+fpu_init (void) {
+	uint32_t mxcsr = 0x1f80;            /* 모든 SIMD 예외 마스크, round-to-nearest. */
+
+	lcr4 (rcr4 () | CR4_OSFXSR | CR4_OSXMMEXCPT);
+	lcr0 ((rcr0 () | CR0_MP) & ~(CR0_EM | CR0_TS));
+	__asm __volatile ("fninit; ldmxcsr %0" : : "m" (mxcsr));
+	fxsave (fpu_initial);
+	lcr0 (rcr0 () | CR0_TS);
+}
+
+// IMAGE로 초기화된 FXSAVE 버퍼를 할당한다. malloc은 16바이트 정렬을
+// 보장하지 않으므로 여유분을 잡고 fpu_image()로 정렬된 주소를 쓴다.
+static void *
+fpu_area_alloc (const void *image) {
+	void *area = malloc (FPU_AREA_SIZE + 15);
+
+	if (area != NULL)
+		memcpy (fpu_image (area), image, FPU_AREA_SIZE);
+	return area;
+}
+
+/* #NM (Device Not Available) 처리. 현재 쓰레드에게 FPU를 넘겨준다.
+   처음 쓰는 쓰레드라면 상태 버퍼를 할당하는데, 실패하면 false를 반환한다.
+   malloc()이 잠들 수 있으므로 인터럽트가 켜진 상태로 호출되어야 한다. */
+bool
+thread_fpu_acquire (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	struct cpu *cpu;
+
+	if (curr->fpu_area == NULL) {
+		curr->fpu_area = fpu_area_alloc (fpu_initial);
+		if (curr->fpu_area == NULL)
+			return false;
+	}
+
+	old_level = intr_disable ();
+	cpu = this_cpu ();
+	clts ();
+	if (cpu->fpu_owner != curr) {
+		if (cpu->fpu_owner != NULL)
+			fxsave (fpu_image (cpu->fpu_owner->fpu_area));
+		fxrstor (fpu_image (curr->fpu_area));
+		cpu->fpu_owner = curr;
+	}
+	intr_set_level (old_level);
+	return true;
+}
+
+/* fork된 자식(현재 쓰레드)에게 PARENT의 FPU 상태를 복사한다.
+   PARENT가 FPU를 한 번도 쓰지 않았다면 아무 것도 하지 않는다. */
+bool
+thread_fpu_fork (struct thread *parent) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	struct cpu *cpu;
+
+	if (parent->fpu_area == NULL)
+		return true;
+
+	old_level = intr_disable ();
+	cpu = this_cpu ();
+	if (cpu->fpu_owner == parent) {
+		/* 최신 상태는 아직 레지스터에 있다. 저장하고 소유권은 내려놓는다. */
+		clts ();
+		fxsave (fpu_image (parent->fpu_area));
+		cpu->fpu_owner = NULL;
+		lcr0 (rcr0 () | CR0_TS);
+	}
+	intr_set_level (old_level);
+
+	curr->fpu_area = fpu_area_alloc (fpu_image (parent->fpu_area));
+	return curr->fpu_area != NULL;
+}
+
+/* 현재 쓰레드의 FPU 상태를 버린다. exec이나 exit에서 호출된다. */
+void
+thread_fpu_release (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	void *area;
+
+	old_level = intr_disable ();
+	if (this_cpu ()->fpu_owner == curr) {
+		this_cpu ()->fpu_owner = NULL;
+		lcr0 (rcr0 () | CR0_TS);
+	}
+	area = curr->fpu_area;
+	curr->fpu_area = NULL;
+	intr_set_level (old_level);
+
+	free (area);
+}
+
 /* Returns a tid to use for a new thread. */
 // lock을 활용하여 다음 tid값을 할당해주는 함수. 락이 대기상태에서 사용가능한 상태로 변경될 때 값을 하나 올려서 tid를 할당한다.
 static tid_t
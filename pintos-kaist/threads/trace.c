@@ -0,0 +1,323 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+#ifdef FILESYS
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#endif
+
+/* Scheduler tracing.
+
+   With the "-trace" option, the scheduler and the synchronization
+   primitives record binary events, stamped with the TSC, into a
+   fixed-size ring buffer per CPU.  When the buffer is full the
+   oldest events are overwritten.  Recording an event touches only
+   the current CPU's buffer, with interrupts off, and never
+   allocates memory, so it is safe inside schedule().
+
+   Alongside the buffer, every thread accumulates histograms of
+   its wakeup latency (from thread_unblock() until it runs) and of
+   the time spent waiting for locks, plus switch and preemption
+   counts.  These survive buffer wraparound.
+
+   trace_dump(), called at power off, prints the statistics and
+   either prints the buffer to the console or, with
+   "-trace=FILE", writes it as raw struct trace_event records to
+   FILE in the file system. */
+
+bool trace_enabled;
+const char *trace_file;
+
+/* Events per CPU buffer. */
+#define TRACE_SIZE 1024
+
+/* Per-CPU ring buffer. */
+struct trace_buf {
+	struct trace_event events[TRACE_SIZE];
+	unsigned long long total;   /* Events ever recorded. */
+};
+
+static struct trace_buf bufs[NCPU];
+
+/* Histogram of latencies in cycles.  Bucket 0 counts latencies
+   under 1024 cycles and each following bucket doubles the bound;
+   the last one counts everything longer. */
+#define TRACE_BUCKETS 16
+#define TRACE_BUCKET_SHIFT 10
+
+struct trace_hist {
+	unsigned cnt;
+	uint64_t sum;
+	uint64_t max;
+	unsigned buckets[TRACE_BUCKETS];
+};
+
+/* Per-thread statistics, hashed by tid.  Once the table is full,
+   new threads go unrecorded. */
+#define TRACE_THREADS 64
+
+struct trace_stats {
+	tid_t tid;                  /* 0 if slot unused. */
+	char name[16];
+	unsigned switches;          /* Times switched in. */
+	unsigned preempts;          /* Times switched out while runnable. */
+	unsigned sema_blocks;       /* Times blocked in sema_down(). */
+	struct trace_hist wakeup;   /* thread_unblock() to running. */
+	struct trace_hist lock_wait;/* lock_acquire() to lock held. */
+};
+
+static struct trace_stats stats[TRACE_THREADS];
+static struct spinlock stats_lock;
+
+static void record (enum trace_type, tid_t, uint64_t arg, uint64_t tsc);
+static unsigned long long oldest (const struct trace_buf *);
+#ifdef FILESYS
+static void write_file (const char *name);
+#endif
+static struct trace_stats *stats_lookup (struct thread *);
+static void hist_add (struct trace_hist *, uint64_t cycles);
+static void hist_print (const char *what, const struct trace_hist *);
+
+/* Initializes the tracer. */
+void
+trace_init (void) {
+	spin_init (&stats_lock);
+}
+
+/* Records that PREV switched out and NEXT switched in.  Called by
+   schedule() with interrupts off. */
+void
+trace_switch (struct thread *prev, struct thread *next) {
+	uint64_t now;
+	struct trace_stats *s;
+
+	if (!trace_enabled)
+		return;
+
+	now = rdtsc ();
+	record (prev->status == THREAD_READY ? TRACE_PREEMPT : TRACE_SWITCH,
+			next->tid, prev->tid, now);
+
+	spin_lock (&stats_lock);
+	if (prev->status == THREAD_READY && (s = stats_lookup (prev)) != NULL)
+		s->preempts++;
+	if ((s = stats_lookup (next)) != NULL) {
+		s->switches++;
+		if (next->trace_wake_tsc != 0)
+			hist_add (&s->wakeup, now - next->trace_wake_tsc);
+	}
+	next->trace_wake_tsc = 0;
+	spin_unlock (&stats_lock);
+}
+
+/* Records that T was made ready to run. */
+void
+trace_wakeup (struct thread *t) {
+	enum intr_level old_level;
+
+	if (!trace_enabled)
+		return;
+
+	old_level = intr_disable ();
+	t->trace_wake_tsc = rdtsc ();
+	record (TRACE_WAKEUP, t->tid, 0, t->trace_wake_tsc);
+	intr_set_level (old_level);
+}
+
+/* Records that the current thread is about to block on SEMA. */
+void
+trace_sema_block (struct semaphore *sema) {
+	struct thread *t = thread_current ();
+	struct trace_stats *s;
+
+	if (!trace_enabled)
+		return;
+
+	record (TRACE_SEMA_BLOCK, t->tid, (uintptr_t) sema, rdtsc ());
+	spin_lock (&stats_lock);
+	if ((s = stats_lookup (t)) != NULL)
+		s->sema_blocks++;
+	spin_unlock (&stats_lock);
+}
+
+/* Records that the current thread must wait for LOCK. */
+void
+trace_lock_wait (struct lock *lock) {
+	struct thread *t = thread_current ();
+
+	if (!trace_enabled)
+		return;
+
+	t->trace_lock_tsc = rdtsc ();
+	record (TRACE_LOCK_WAIT, t->tid, (uintptr_t) lock, t->trace_lock_tsc);
+}
+
+/* Records that the current thread got LOCK after waiting. */
+void
+trace_lock_acquired (struct lock *lock) {
+	struct thread *t = thread_current ();
+	struct trace_stats *s;
+	uint64_t now;
+
+	if (!trace_enabled || t->trace_lock_tsc == 0)
+		return;
+
+	now = rdtsc ();
+	record (TRACE_LOCK_ACQUIRED, t->tid, (uintptr_t) lock, now);
+	spin_lock (&stats_lock);
+	if ((s = stats_lookup (t)) != NULL)
+		hist_add (&s->lock_wait, now - t->trace_lock_tsc);
+	spin_unlock (&stats_lock);
+	t->trace_lock_tsc = 0;
+}
+
+/* Prints per-thread statistics and dumps the trace buffers to the
+   console or to trace_file. */
+void
+trace_dump (void) {
+	static const char *names[] = {
+		"switch", "preempt", "wakeup", "sema-block", "lock-wait", "lock-acquired",
+	};
+	size_t i;
+	int c;
+
+	if (!trace_enabled)
+		return;
+	trace_enabled = false;
+
+	for (i = 0; i < TRACE_THREADS; i++) {
+		struct trace_stats *s = &stats[i];
+		if (s->tid == 0)
+			continue;
+		printf ("Trace %s (tid %d): %u switches, %u preempted, %u sema blocks\n",
+				s->name, s->tid, s->switches, s->preempts, s->sema_blocks);
+		hist_print ("wakeup latency", &s->wakeup);
+		hist_print ("lock wait", &s->lock_wait);
+	}
+
+#ifdef FILESYS
+	if (trace_file != NULL) {
+		write_file (trace_file);
+		return;
+	}
+#endif
+	for (c = 0; c < NCPU; c++) {
+		struct trace_buf *b = &bufs[c];
+		unsigned long long n;
+
+		printf ("Trace cpu%d: %llu events, %llu overwritten\n",
+				c, b->total, oldest (b));
+		for (n = oldest (b); n < b->total; n++) {
+			struct trace_event *e = &b->events[n % TRACE_SIZE];
+			if (e->type == TRACE_SWITCH || e->type == TRACE_PREEMPT)
+				printf ("%llu cpu%d %s tid %d prev %d\n", (unsigned long long) e->tsc,
+						e->cpu, names[e->type], e->tid, (int) e->arg);
+			else
+				printf ("%llu cpu%d %s tid %d arg %#llx\n", (unsigned long long) e->tsc,
+						e->cpu, names[e->type], e->tid, (unsigned long long) e->arg);
+		}
+	}
+}
+
+/* Index of the oldest event still in B. */
+static unsigned long long
+oldest (const struct trace_buf *b) {
+	return b->total > TRACE_SIZE ? b->total - TRACE_SIZE : 0;
+}
+
+#ifdef FILESYS
+/* Writes every CPU's events, oldest first, to a new file NAME. */
+static void
+write_file (const char *name) {
+	off_t size = 0;
+	struct file *file;
+	int c;
+
+	for (c = 0; c < NCPU; c++)
+		size += (bufs[c].total - oldest (&bufs[c])) * sizeof (struct trace_event);
+	if (!filesys_create (name, size) || (file = filesys_open (name)) == NULL) {
+		printf ("%s: create failed\n", name);
+		return;
+	}
+	for (c = 0; c < NCPU; c++) {
+		struct trace_buf *b = &bufs[c];
+		for (unsigned long long n = oldest (b); n < b->total; n++)
+			file_write (file, &b->events[n % TRACE_SIZE], sizeof (struct trace_event));
+	}
+	file_close (file);
+	printf ("Trace: %d bytes written to %s\n", size, name);
+}
+#endif
+
+/* Appends an event to the current CPU's buffer. */
+static void
+record (enum trace_type type, tid_t tid, uint64_t arg, uint64_t tsc) {
+	enum intr_level old_level = intr_disable ();
+	int cpu = thread_cpu_id ();
+	struct trace_buf *b = &bufs[cpu];
+	struct trace_event *e = &b->events[b->total++ % TRACE_SIZE];
+
+	e->tsc = tsc;
+	e->tid = tid;
+	e->arg = arg;
+	e->type = type;
+	e->cpu = cpu;
+	e->pad = 0;
+	intr_set_level (old_level);
+}
+
+/* Returns T's statistics, creating them if needed, or NULL if the
+   table is full.  stats_lock must be held. */
+static struct trace_stats *
+stats_lookup (struct thread *t) {
+	size_t start = (unsigned) t->tid % TRACE_THREADS;
+	size_t i = start;
+
+	ASSERT (spin_held_by_current_thread (&stats_lock));
+	do {
+		struct trace_stats *s = &stats[i];
+		if (s->tid == t->tid)
+			return s;
+		if (s->tid == 0) {
+			s->tid = t->tid;
+			strlcpy (s->name, t->name, sizeof s->name);
+			return s;
+		}
+		i = (i + 1) % TRACE_THREADS;
+	} while (i != start);
+	return NULL;
+}
+
+/* Adds a latency of CYCLES to H. */
+static void
+hist_add (struct trace_hist *h, uint64_t cycles) {
+	int b = 0;
+
+	while (b < TRACE_BUCKETS - 1 && cycles >= (1ull << (TRACE_BUCKET_SHIFT + b)))
+		b++;
+	h->buckets[b]++;
+	h->cnt++;
+	h->sum += cycles;
+	if (cycles > h->max)
+		h->max = cycles;
+}
+
+/* Prints histogram H, labeled WHAT, if it has any samples. */
+static void
+hist_print (const char *what, const struct trace_hist *h) {
+	if (h->cnt == 0)
+		return;
+
+	printf ("  %s: %u samples, avg %llu, max %llu cycles\n  ", what, h->cnt,
+			(unsigned long long) (h->sum / h->cnt), (unsigned long long) h->max);
+	for (int b = 0; b < TRACE_BUCKETS; b++)
+		if (h->buckets[b] != 0)
+			printf (" %s2^%d:%u", b < TRACE_BUCKETS - 1 ? "<" : ">=",
+					TRACE_BUCKET_SHIFT + b - (b == TRACE_BUCKETS - 1), h->buckets[b]);
+	printf ("\n");
+}
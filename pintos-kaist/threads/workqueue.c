@@ -0,0 +1,217 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "intrinsic.h"
+
+/* Work queues for deferred kernel work.
+
+   A caller that has work it should not do on its own path, such as
+   writing back or zeroing pages, fills in a struct work and submits
+   it.  One of the queue's worker threads later calls the work's
+   function in an ordinary kernel thread context, where it may sleep.
+
+   Each queue has a fixed number of workers per CPU, all at the
+   queue's priority, created up front so that submission never has
+   to create threads.  Work is queued on the submitting CPU's pool
+   and run by that pool's workers, so it tends to stay on the CPU
+   whose caches hold its data.  Workers are not pinned, though; the
+   scheduler may still move them when it balances load.
+
+   work_submit() and work_cancel() take only a spinlock and never
+   sleep, so they may be called with interrupts off and from
+   interrupt handlers. */
+
+struct workqueue system_wq;
+struct workqueue system_bg_wq;
+
+/* Registered queues, for workqueue_print_stats(). */
+static struct workqueue *queues[8];
+static size_t queue_cnt;
+
+static void worker (void *pool_);
+
+/* Creates the system work queues.  Must be called after the
+   scheduler has started. */
+void
+workqueue_init (void) {
+	if (!workqueue_create (&system_wq, "events", PRI_DEFAULT, 2)
+			|| !workqueue_create (&system_bg_wq, "events_bg", PRI_MIN + 1, 1))
+		PANIC ("cannot create system work queues");
+}
+
+/* Initializes WQ and starts WORKERS worker threads per CPU at
+   PRIORITY.  Returns false if a thread could not be created, in
+   which case the workers already started keep serving WQ. */
+bool
+workqueue_create (struct workqueue *wq, const char *name, int priority,
+		int workers) {
+	int c, i;
+
+	ASSERT (wq != NULL && name != NULL);
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+	ASSERT (0 < workers && workers <= WQ_MAX_WORKERS);
+	ASSERT (queue_cnt < sizeof queues / sizeof *queues);
+
+	wq->name = name;
+	wq->priority = priority;
+	wq->workers = workers;
+	for (c = 0; c < NCPU; c++) {
+		struct wq_pool *pool = &wq->pools[c];
+
+		pool->wq = wq;
+		spin_init (&pool->lock);
+		list_init (&pool->pending);
+		sema_init (&pool->items, 0);
+		pool->depth = 0;
+		pool->submitted = pool->executed = pool->cancelled = 0;
+		pool->max_depth = 0;
+		pool->wait_cycles = pool->max_wait_cycles = 0;
+	}
+	queues[queue_cnt++] = wq;
+
+	for (c = 0; c < NCPU; c++)
+		for (i = 0; i < workers; i++) {
+			char thread_name[16];
+
+			snprintf (thread_name, sizeof thread_name, "%s/%d:%d", name, c, i);
+			if (thread_create (thread_name, priority, worker, &wq->pools[c])
+					== TID_ERROR)
+				return false;
+		}
+	return true;
+}
+
+/* Initializes W to call FUNC(AUX). */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	ASSERT (w != NULL && func != NULL);
+
+	w->func = func;
+	w->aux = aux;
+	w->pool = NULL;
+}
+
+/* Queues W on WQ.  Returns false, without queuing it again, if W
+   is already pending.  W must not be freed or reinitialized until
+   its function has started or it has been cancelled. */
+bool
+work_submit (struct workqueue *wq, struct work *w) {
+	struct wq_pool *pool = &wq->pools[thread_cpu_id ()];
+	bool queued = false;
+
+	spin_lock (&pool->lock);
+	if (w->pool == NULL) {
+		w->pool = pool;
+		w->queued_tsc = rdtsc ();
+		list_push_back (&pool->pending, &w->elem);
+		if (++pool->depth > pool->max_depth)
+			pool->max_depth = pool->depth;
+		pool->submitted++;
+		queued = true;
+	}
+	spin_unlock (&pool->lock);
+
+	if (queued)
+		sema_up (&pool->items);
+	return queued;
+}
+
+/* Removes W from its queue if it has not started yet.  Returns
+   true if it was cancelled, false if it was not pending. */
+bool
+work_cancel (struct work *w) {
+	/* A worker may clear W->pool at any time, so read it once and
+	   check it again under the pool's lock.  The semaphore keeps
+	   the cancelled item's count; the worker that takes it finds
+	   nothing to run and goes back to sleep. */
+	struct wq_pool *pool = w->pool;
+	bool cancelled = false;
+
+	if (pool != NULL) {
+		spin_lock (&pool->lock);
+		if (w->pool == pool) {
+			list_remove (&w->elem);
+			w->pool = NULL;
+			pool->depth--;
+			pool->cancelled++;
+			cancelled = true;
+		}
+		spin_unlock (&pool->lock);
+	}
+	return cancelled;
+}
+
+/* Returns true if W is queued and has not started. */
+bool
+work_pending (const struct work *w) {
+	return w->pool != NULL;
+}
+
+/* Prints statistics for every work queue. */
+void
+workqueue_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < queue_cnt; i++) {
+		struct workqueue *wq = queues[i];
+		unsigned long long submitted = 0, executed = 0, cancelled = 0;
+		unsigned long long wait_cycles = 0, max_wait_cycles = 0;
+		int depth = 0, max_depth = 0;
+		int c;
+
+		for (c = 0; c < NCPU; c++) {
+			struct wq_pool *pool = &wq->pools[c];
+
+			submitted += pool->submitted;
+			executed += pool->executed;
+			cancelled += pool->cancelled;
+			wait_cycles += pool->wait_cycles;
+			if (pool->max_wait_cycles > max_wait_cycles)
+				max_wait_cycles = pool->max_wait_cycles;
+			depth += pool->depth;
+			if (pool->max_depth > max_depth)
+				max_depth = pool->max_depth;
+		}
+		printf ("Workqueue %s: %llu submitted, %llu run, %llu cancelled, "
+				"depth %d (max %d), wait avg %llu max %llu cycles\n",
+				wq->name, submitted, executed, cancelled, depth, max_depth,
+				executed != 0 ? wait_cycles / executed : 0, max_wait_cycles);
+	}
+}
+
+/* Worker thread.  Runs the work submitted to POOL_, oldest first. */
+static void
+worker (void *pool_) {
+	struct wq_pool *pool = pool_;
+
+	for (;;) {
+		struct work *w;
+		work_func *func;
+		void *aux;
+		uint64_t wait;
+
+		sema_down (&pool->items);
+
+		spin_lock (&pool->lock);
+		if (list_empty (&pool->pending)) {
+			/* The item we were woken for was cancelled. */
+			spin_unlock (&pool->lock);
+			continue;
+		}
+		w = list_entry (list_pop_front (&pool->pending), struct work, elem);
+		pool->depth--;
+		w->pool = NULL;
+		func = w->func;
+		aux = w->aux;
+		wait = rdtsc () - w->queued_tsc;
+		pool->executed++;
+		pool->wait_cycles += wait;
+		if (wait > pool->max_wait_cycles)
+			pool->max_wait_cycles = wait;
+		spin_unlock (&pool->lock);
+
+		/* W now belongs to its owner again, who may free or resubmit
+		   it from FUNC. */
+		func (aux);
+	}
+}
@@ -11,6 +11,7 @@ static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static void device_not_available (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -45,7 +46,7 @@ exception_init (void) {
 	intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
 	intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
 	intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-	intr_register_int (7, 0, INTR_ON, kill,
+	intr_register_int (7, 0, INTR_ON, device_not_available,
 			"#NM Device Not Available Exception");
 	intr_register_int (11, 0, INTR_ON, kill, "#NP Segment Not Present");
 	intr_register_int (12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
@@ -105,6 +106,16 @@ kill (struct intr_frame *f) {
 	}
 }
 
+/* #NM handler.  CR0.TS is set on every thread switch, so the
+   first FPU/SSE instruction after a switch lands here and we
+   hand the FPU over to the current thread (see thread.c).  Only
+   kill the process if its save area cannot be allocated. */
+static void
+device_not_available (struct intr_frame *f) {
+	if (!thread_fpu_acquire ())
+		kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
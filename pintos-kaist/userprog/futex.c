@@ -0,0 +1,193 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+
+/* Fast user-space mutexes.
+
+   A futex is any aligned int in user memory.  User code updates it
+   with atomic instructions and only enters the kernel to sleep when
+   the value says the lock is taken, or to wake sleepers when it
+   says someone is waiting.  The kernel knows nothing about what the
+   value means.
+
+   Sleepers are kept in a queue per (process, address), found
+   through a hash table.  A queue exists only while it has waiters.
+   Futexes are private to a process: threads of other processes
+   waiting on the same virtual address are in different queues.
+
+   When a process exits as a group, futex_wake_all() wakes all of
+   its sleepers so that they notice and terminate, and futex_wait()
+   refuses to sleep from then on. */
+
+/* Wait queue for one futex. */
+struct futex_queue {
+	struct hash_elem elem;      /* futex_table element. */
+	struct list_elem wake_elem; /* futex_wake_all() list element. */
+	struct process *proc;       /* Owning process. */
+	int *uaddr;                 /* User address of the futex. */
+	struct list waiters;        /* List of struct futex_waiter. */
+};
+
+/* A thread sleeping in futex_wait(), on its kernel stack. */
+struct futex_waiter {
+	struct list_elem elem;      /* futex_queue's waiters element. */
+	struct semaphore sema;      /* Upped by futex_wake(). */
+};
+
+/* All futex queues with waiters, and the lock that protects them
+   and the queues' waiter lists. */
+static struct hash futex_table;
+static struct lock futex_lock;
+
+static hash_hash_func futex_hash;
+static hash_less_func futex_less;
+static struct futex_queue *queue_lookup (int *uaddr, bool create);
+
+/* Initializes the futex table. */
+void
+futex_init (void) {
+	hash_init (&futex_table, futex_hash, futex_less, NULL);
+	lock_init (&futex_lock);
+}
+
+/* If *UADDR equals VAL, sleeps until a futex_wake() on UADDR and
+   returns true.  Otherwise returns false at once.  The comparison
+   and going to sleep are atomic with respect to futex_wake(), so a
+   wakeup that follows the user's change to *UADDR is never missed.
+   UADDR must be a valid, aligned user address. */
+bool
+futex_wait (int *uaddr, int val) {
+	struct futex_waiter w;
+	struct futex_queue *q;
+
+	ASSERT (((uintptr_t) uaddr & (sizeof *uaddr - 1)) == 0);
+
+	lock_acquire (&futex_lock);
+	if (thread_current ()->proc->exiting
+			|| *(volatile int *) uaddr != val
+			|| (q = queue_lookup (uaddr, true)) == NULL) {
+		lock_release (&futex_lock);
+		return false;
+	}
+	sema_init (&w.sema, 0);
+	list_push_back (&q->waiters, &w.elem);
+	lock_release (&futex_lock);
+
+	sema_down (&w.sema);
+	return true;
+}
+
+/* Wakes up to CNT threads waiting on UADDR, oldest first, and
+   returns the number woken. */
+int
+futex_wake (int *uaddr, int cnt) {
+	struct futex_queue *q;
+	int woken = 0;
+
+	lock_acquire (&futex_lock);
+	q = queue_lookup (uaddr, false);
+	if (q != NULL) {
+		/* Finish waking everyone before any of them runs. */
+		thread_preempt_disable ();
+		while (woken < cnt && !list_empty (&q->waiters)) {
+			struct futex_waiter *w = list_entry (list_pop_front (&q->waiters),
+					struct futex_waiter, elem);
+			sema_up (&w->sema);
+			woken++;
+		}
+		if (list_empty (&q->waiters)) {
+			hash_delete (&futex_table, &q->elem);
+			free (q);
+		}
+		lock_release (&futex_lock);
+		thread_preempt_enable ();
+	} else
+		lock_release (&futex_lock);
+	return woken;
+}
+
+/* Wakes every thread of PROC sleeping on any futex.  PROC must
+   already be marked as exiting. */
+void
+futex_wake_all (struct process *proc) {
+	struct hash_iterator i;
+	struct list queues;
+
+	ASSERT (proc->exiting);
+
+	list_init (&queues);
+	lock_acquire (&futex_lock);
+	hash_first (&i, &futex_table);
+	while (hash_next (&i)) {
+		struct futex_queue *q = hash_entry (hash_cur (&i), struct futex_queue, elem);
+		if (q->proc == proc)
+			list_push_back (&queues, &q->wake_elem);
+	}
+
+	thread_preempt_disable ();
+	while (!list_empty (&queues)) {
+		struct futex_queue *q = list_entry (list_pop_front (&queues),
+				struct futex_queue, wake_elem);
+		while (!list_empty (&q->waiters))
+			sema_up (&list_entry (list_pop_front (&q->waiters),
+						struct futex_waiter, elem)->sema);
+		hash_delete (&futex_table, &q->elem);
+		free (q);
+	}
+	lock_release (&futex_lock);
+	thread_preempt_enable ();
+}
+
+/* Returns the queue for UADDR in the current process.  If there is
+   none, creates one if CREATE is true, or returns a null pointer.
+   Also returns a null pointer if memory is not available.  The
+   caller must hold futex_lock. */
+static struct futex_queue *
+queue_lookup (int *uaddr, bool create) {
+	struct futex_queue key, *q;
+	struct hash_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&futex_lock));
+
+	key.proc = thread_current ()->proc;
+	key.uaddr = uaddr;
+	e = hash_find (&futex_table, &key.elem);
+	if (e != NULL)
+		return hash_entry (e, struct futex_queue, elem);
+	if (!create)
+		return NULL;
+
+	q = malloc (sizeof *q);
+	if (q != NULL) {
+		q->proc = key.proc;
+		q->uaddr = uaddr;
+		list_init (&q->waiters);
+		hash_insert (&futex_table, &q->elem);
+	}
+	return q;
+}
+
+/* Returns a hash value for futex queue E. */
+static uint64_t
+futex_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct futex_queue *q = hash_entry (e, struct futex_queue, elem);
+	uintptr_t key[2] = { (uintptr_t) q->proc, (uintptr_t) q->uaddr };
+	return hash_bytes (key, sizeof key);
+}
+
+/* Returns true if futex queue A precedes B. */
+static bool
+futex_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct futex_queue *a = hash_entry (a_, struct futex_queue, elem);
+	const struct futex_queue *b = hash_entry (b_, struct futex_queue, elem);
+
+	if (a->proc != b->proc)
+		return a->proc < b->proc;
+	return a->uaddr < b->uaddr;
+}
@@ -13,12 +13,15 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "intrinsic.h"
+#include "userprog/futex.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -27,11 +30,67 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void start_thread (void *);
+static void *alloc_thread_stack (int *slotp);
+static void free_thread_stack (int slot);
+
+/* 쓰레드 스택 배치.
+ * 메인 스택이 자랄 자리로 USER_STACK 아래 MAIN_STACK_MAX를 비워 두고,
+ * 그 아래에 THREAD_STACK_SPAN 간격으로 쓰레드 스택 슬롯을 둔다.
+ * 각 슬롯은 위쪽 THREAD_STACK_PAGES 페이지만 매핑하고 나머지는
+ * 가드 영역으로 남겨 스택 넘침이 다른 스택을 덮지 않고 폴트를 낸다. */
+#define MAIN_STACK_MAX (1 << 20)
+#define THREAD_STACK_SPAN (16 * PGSIZE)
+#define THREAD_STACK_PAGES 4
+
+/* 슬롯 SLOT의 스택 꼭대기 주소. */
+#define THREAD_STACK_TOP(SLOT) \
+	((uint8_t *) USER_STACK - MAIN_STACK_MAX - (SLOT) * THREAD_STACK_SPAN)
+
+/* fork 인자(f_thread) 캐시. */
+static struct slab_cache f_thread_cache;
+
+/* struct process 캐시. */
+static struct slab_cache process_cache;
+
+/* process_create_thread()가 새 쓰레드에 넘기는 인자. */
+struct thread_start {
+	struct process *proc;
+	void *entry;
+	void *arg;
+	void *stack;
+	int stack_slot;
+};
 
-/* initd 및 기타 프로세스를 위한 일반적인 프로세스 초기화 함수 */
-static void
+/* 프로세스 관련 객체 캐시를 초기화한다. */
+void
+process_cache_init (void) {
+	slab_cache_init (&f_thread_cache, "f_thread", sizeof (struct f_thread), 4);
+	slab_cache_init (&process_cache, "process", sizeof (struct process), 4);
+}
+
+/* initd 및 기타 프로세스를 위한 일반적인 프로세스 초기화 함수.
+ * 현재 쓰레드에 빈 struct process를 붙인다. 메모리가 없으면 false. */
+static bool
 process_init (void) {
 	struct thread *current = thread_current ();
+	struct process *proc = slab_alloc (&process_cache);
+
+	if (proc == NULL)
+		return false;
+	memset (proc, 0, sizeof *proc);
+	proc->thread_cnt = 1;
+	proc->pid = current->tid;
+	proc->parent = current->parent;
+	sema_init (&proc->exit_sema, 0);
+	list_init (&proc->sleepers);
+	proc->next_fd = 2;
+	current->stack_slot = -1;
+#ifdef VM
+	supplemental_page_table_init (&proc->spt);
+#endif
+	current->proc = proc;
+	return true;
 }
 
 /* FILE_NAME에서 로드된 "initd"라는 첫 번째 유저랜드 프로그램을 시작한다.
@@ -68,11 +127,8 @@ process_create_initd (const char *file_name) { //run_task에서 파라미터에
 /* 첫 번째 사용자 프로세스를 실행하는 스레드 함수. */
 static void
 initd (void *f_name) {
-#ifdef VM
-	supplemental_page_table_init (&thread_current ()->spt);
-#endif
-
-	process_init ();
+	if (!process_init ())
+		PANIC("Fail to launch initd\n");
 
 	if (process_exec (f_name) < 0)
 		PANIC("Fail to launch initd\n");
@@ -84,7 +140,7 @@ initd (void *f_name) {
  * 실패한 경우 TID_ERROR를 반환합니다. */
 tid_t
 process_fork (const char *name, struct intr_frame *if_ UNUSED) {
-    struct f_thread *ft = palloc_get_page(PAL_ZERO);
+    struct f_thread *ft = slab_alloc(&f_thread_cache);
     if (ft == NULL)
         return TID_ERROR;
 
@@ -93,13 +149,13 @@ process_fork (const char *name, struct intr_frame *if_ UNUSED) {
 
     tid_t tid = thread_create(name, PRI_DEFAULT, __do_fork, ft);
     if (tid == TID_ERROR){
-		palloc_free_page(ft);
+		slab_free(&f_thread_cache, ft);
 		return TID_ERROR; 
 	}
 
     sema_down(&thread_current()->fork_sema); // 자식이 fork 완료 후 signal할 때까지 대기
 	if(!thread_current()->fork_succ){	
-		palloc_free_page(ft);
+		slab_free(&f_thread_cache, ft);
 		return TID_ERROR;
 	}
     return tid;
@@ -125,15 +181,41 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	parent_page = pml4_get_page(parent->pml4, va);
 	if (parent_page == NULL)
 		return false;
+	writable = is_writable(pte);
+
+	/* 큰 페이지는 큰 페이지로 복제하되, 실패하면 4 kB 페이지로 나눠 복제 */
+	if (is_large_pte(pte)) {
+		size_t ofs;
+
+		newpage = palloc_get_large(PAL_USER);
+		if (newpage != NULL) {
+			memcpy(newpage, parent_page, LPGSIZE);
+			if (pml4_set_large_page(current->pml4, va, newpage, writable))
+				return true;
+			palloc_free_multiple(newpage, LPGSIZE / PGSIZE);
+			return false;
+		}
+		for (ofs = 0; ofs < LPGSIZE; ofs += PGSIZE) {
+			newpage = palloc_get_page(PAL_USER);
+			if (newpage == NULL)
+				return false;
+			memcpy(newpage, (uint8_t *) parent_page + ofs, PGSIZE);
+			if (!pml4_set_page(current->pml4, (uint8_t *) va + ofs, newpage,
+						writable)) {
+				palloc_free_page(newpage);
+				return false;
+			}
+		}
+		return true;
+	}
 
 	/* 3. 자식용 새 페이지 할당 */
 	newpage = palloc_get_page(PAL_USER);
 	if (newpage == NULL)
 		return false;
 
-	/* 4. 내용 복사 및 writable 여부 판단 */
+	/* 4. 내용 복사 */
 	memcpy(newpage, parent_page, PGSIZE);
-	writable = is_writable(pte);
 
 	/* 5. 자식의 페이지 테이블에 등록 */
 	if (!pml4_set_page(current->pml4, va, newpage, writable)) {
@@ -159,16 +241,19 @@ __do_fork (void *aux) {
 	bool succ = true;
 	/* 1. 부모의 레지스터 상태를 지역 스택으로 복사합니다. */
 	memcpy (&if_, parent_if, sizeof (struct intr_frame));
+	if (!thread_fpu_fork (parent))
+		goto error;
 
 	/* 2. 부모의 페이지 테이블(주소 공간)을 복제합니다. */
-	current->pml4 = pml4_create();
+	if (!process_init ())
+		goto error;
+	current->pml4 = current->proc->pml4 = pml4_create();
 	if (current->pml4 == NULL)
 		goto error;
 
 	process_activate (current);
 #ifdef VM
-	supplemental_page_table_init (&current->spt);
-	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
+	if (!supplemental_page_table_copy (&current->proc->spt, &parent->proc->spt))
 		goto error;
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
@@ -179,22 +264,25 @@ __do_fork (void *aux) {
 	 * TODO: 파일 객체를 복제할 때는 include/filesys/file.h의 file_duplicate를 사용하세요.
 	 * TODO: 부모는 자식 리소스 복제가 전부 성공한 후에만 fork()에서 반환되어야 합니다. */
 	for(int i=2; i<64; i++){
-		if(parent->fdt[i] != NULL){
-			current->fdt[i] = file_duplicate(parent->fdt[i]);
-			if(current->fdt[i]==NULL){
+		if(parent->proc->fdt[i] != NULL){
+			current->proc->fdt[i] = file_duplicate(parent->proc->fdt[i]);
+			if(current->proc->fdt[i]==NULL){
 				goto error;
 			}
 		}
 	}
 	if_.R.rax = 0;  // 자식 스레드 return값은 0
-	process_init ();
+	/* 부모의 다른 쓰레드 스택도 그대로 복사되었으므로 슬롯을 이어받는다. */
+	current->proc->stack_slots = parent->proc->stack_slots;
+	current->stack_slot = parent->stack_slot;
 	
-	palloc_free_page(f_parent);
+	slab_free(&f_thread_cache, f_parent);
 	parent->fork_succ = true;
 	sema_up(&parent->fork_sema);
 	
 	/* 복제가 성공적으로 끝났다면, 자식 프로세스를 실행합니다. */
 	if (succ){
+		thread_acct_mode (true);
 		do_iret (&if_);
 	}
 		
@@ -237,6 +325,7 @@ process_exec (void *f_name) { //실행하려는 바이너리 파일의 이름?
 
 	/* 먼저 현재 컨텍스트를 종료(kill)한다. */
 	process_cleanup ();
+	thread_fpu_release ();
 
 
 ///////////////////////////////////////
@@ -304,6 +393,7 @@ process_exec (void *f_name) { //실행하려는 바이너리 파일의 이름?
 
 	/* 전환된 프로세스를 시작한다.. */
 	//printf("Jumping to user process...\n");
+	thread_acct_mode (true);
 	do_iret (&_if); //실행할 레지스터를 잘 지정해야 한다?
 	NOT_REACHED ();
 }
@@ -337,12 +427,13 @@ process_wait (tid_t child_tid) {
 
 			// 자식이 아직 종료되지 않았으면 대기
 			if (!cs->has_exited)
-				sema_down(&cs->wait_sema);
+				process_sleep(&cs->wait_sema);
 
-			// 자식의 종료 상태 수거 및 정리
-			int status = cs->exit_status;
+			// 자식의 종료 상태 수거 및 정리. 그룹 종료로 먼저 깨어났다면
+			// 자식은 더 이상 이 항목을 찾지 못하므로 -1을 반환한다.
+			int status = cs->has_exited ? cs->exit_status : -1;
 			list_remove(&cs->elem);
-			palloc_free_page(cs);
+			slab_free(&child_status_cache, cs);
 			return status;
 		}
 	}
@@ -356,30 +447,291 @@ process_wait (tid_t child_tid) {
 void
 process_exit (void) {
 	struct thread *cur = thread_current ();
-	/* TODO: Your code goes here.
-	 * TODO: Implement process termination message (see
-	 * TODO: project2/process_termination.html).
-	 * TODO: We recommend you to implement process resource cleanup here. */
+	struct process *proc = cur->proc;
+	enum intr_level old_level;
+	bool last;
+
+	if (proc == NULL)
+		return;
+
+	/* 마지막 쓰레드만 공유 자원을 정리한다. 나머지는 주소 공간에서
+	 * 빠져나오기만 한다. */
+	if (cur->stack_slot >= 0) {
+		free_thread_stack (cur->stack_slot);
+		cur->stack_slot = -1;
+	}
+	old_level = intr_disable ();
+	last = --proc->thread_cnt == 0;
+	/* exit()한 쓰레드가 나머지를 기다리고 있으면 마지막으로 깨운다. */
+	if (proc->exiting && proc->thread_cnt == 1)
+		sema_up (&proc->exit_sema);
+	intr_set_level (old_level);
+	if (!last) {
+		cur->pml4 = NULL;
+		pml4_activate (NULL);
+		cur->proc = NULL;
+		return;
+	}
+
 	for(int i=2; i<64; i++){
-		if(cur->fdt[i]!=NULL){
-			file_close(cur->fdt[i]);
-			cur->fdt[i] = NULL;
+		if(proc->fdt[i]!=NULL){
+			file_close(proc->fdt[i]);
+			proc->fdt[i] = NULL;
 		}
 	}
 	process_cleanup ();
+	cur->proc = NULL;
+	slab_free (&process_cache, proc);
+}
+
+/* 현재 프로세스에 다른 쓰레드가 있으면 true. */
+bool
+process_is_shared (void) {
+	struct process *proc = thread_current ()->proc;
+	return proc != NULL && proc->thread_cnt > 1;
+}
+
+/* 현재 쓰레드가 exit()로 프로세스 전체를 끝낸다.
+ * 다른 쓰레드를 모두 종료시키고 그들이 나갈 때까지 기다린 뒤 true를
+ * 반환한다. 이미 다른 쓰레드가 exit()를 진행 중이면 false를 반환하며,
+ * 이때 호출자는 조용히 종료해야 한다. */
+bool
+process_begin_exit (void) {
+	struct process *proc = thread_current ()->proc;
+	enum intr_level old_level;
+	bool wait;
+
+	old_level = intr_disable ();
+	if (proc->exiting) {
+		intr_set_level (old_level);
+		return false;
+	}
+	proc->exiting = true;
+	wait = proc->thread_cnt > 1;
+	intr_set_level (old_level);
+
+	/* futex, wait(), 콘솔 read()에서 자는 쓰레드는 깨워야 종료를 알아챈다.
+	 * 나머지는 다음에 유저 모드로 돌아가려 할 때 process_check_exit()에서
+	 * 끝난다. lock을 기다리는 쓰레드는 holder가 놓는 대로 진행하므로 따로
+	 * 깨우지 않는다. 다른 커널 잠은 끝날 때까지 exit()가 기다린다. */
+	if (wait) {
+		futex_wake_all (proc);
+		thread_preempt_disable ();
+		old_level = intr_disable ();
+		while (!list_empty (&proc->sleepers)) {
+			struct thread *t = list_entry (list_pop_front (&proc->sleepers),
+					struct thread, sleep_elem);
+			sema_up (t->sleep_sema);
+			t->sleep_sema = NULL;
+		}
+		intr_set_level (old_level);
+		thread_preempt_enable ();
+		sema_down (&proc->exit_sema);
+	}
+	return true;
+}
+
+/* SEMA를 down하되, 프로세스가 그룹 종료를 시작하면 일찍 깨어난다.
+ * 이미 종료 중이면 자지 않고 바로 반환한다. 어느 쪽으로 깨어났는지는
+ * 알려주지 않으므로 호출자는 기다리던 조건을 다시 확인해야 한다.
+ * 커널 쓰레드라면 그냥 sema_down()한다. */
+void
+process_sleep (struct semaphore *sema) {
+	struct thread *cur = thread_current ();
+	struct process *proc = cur->proc;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (proc == NULL)
+		sema_down (sema);
+	else if (!proc->exiting) {
+		cur->sleep_sema = sema;
+		list_push_back (&proc->sleepers, &cur->sleep_elem);
+		sema_down (sema);
+		/* process_begin_exit()가 깨웠다면 이미 목록에서 빠졌다. */
+		if (cur->sleep_sema != NULL)
+			list_remove (&cur->sleep_elem);
+		cur->sleep_sema = NULL;
+	}
+	intr_set_level (old_level);
+}
+
+/* 현재 쓰레드의 프로세스가 그룹 종료 중이면 쓰레드를 끝낸다.
+ * 유저 모드로 돌아가기 직전에 호출한다. */
+void
+process_check_exit (void) {
+	struct process *proc = thread_current ()->proc;
+
+	if (proc != NULL && proc->exiting) {
+		intr_enable ();
+		thread_exit ();
+	}
+}
+
+/* 현재 프로세스 안에 새 유저 쓰레드를 만든다. 새 쓰레드는 주소 공간과
+ * 파일 테이블을 공유하며, 유저 스택 STACK 위에서 ENTRY(ARG)를 실행한다.
+ * STACK이 NULL이면 USER_STACK 아래의 빈 슬롯에 스택을 할당한다.
+ * 쓰레드 ID를 반환하며, 실패하면 TID_ERROR를 반환한다. */
+tid_t
+process_create_thread (void *entry, void *arg, void *stack) {
+	struct thread *cur = thread_current ();
+	struct process *proc = cur->proc;
+	struct thread_start *ts;
+	enum intr_level old_level;
+	int slot = -1;
+	tid_t tid;
+
+	ts = malloc (sizeof *ts);
+	if (ts == NULL)
+		return TID_ERROR;
+	if (stack == NULL && (stack = alloc_thread_stack (&slot)) == NULL) {
+		free (ts);
+		return TID_ERROR;
+	}
+	ts->proc = proc;
+	ts->entry = entry;
+	ts->arg = arg;
+	ts->stack = stack;
+	ts->stack_slot = slot;
+
+	/* 새 쓰레드가 붙기 전에 프로세스가 해제되지 않도록 먼저 센다.
+	 * 그룹 종료가 시작된 뒤에는 쓰레드를 늘리지 않는다. */
+	old_level = intr_disable ();
+	tid = proc->exiting ? TID_ERROR : 0;
+	if (tid != TID_ERROR)
+		proc->thread_cnt++;
+	intr_set_level (old_level);
+
+	if (tid != TID_ERROR) {
+		tid = thread_create (cur->name, cur->priority, start_thread, ts);
+		if (tid == TID_ERROR) {
+			old_level = intr_disable ();
+			if (--proc->thread_cnt == 1 && proc->exiting)
+				sema_up (&proc->exit_sema);
+			intr_set_level (old_level);
+		}
+	}
+	if (tid == TID_ERROR) {
+		if (slot >= 0)
+			free_thread_stack (slot);
+		free (ts);
+	}
+	return tid;
+}
+
+/* process_create_thread()로 만든 쓰레드의 시작 함수.
+ * 공유 주소 공간으로 전환한 뒤 유저 모드로 들어간다. */
+static void
+start_thread (void *aux) {
+	struct thread_start *ts = aux;
+	struct thread *cur = thread_current ();
+	struct intr_frame if_;
+
+	cur->proc = ts->proc;
+	cur->pml4 = ts->proc->pml4;
+	cur->stack_slot = ts->stack_slot;
+	process_activate (cur);
+
+	memset (&if_, 0, sizeof if_);
+	if_.ds = if_.es = if_.ss = SEL_UDSEG;
+	if_.cs = SEL_UCSEG;
+	if_.eflags = FLAG_IF | FLAG_MBS;
+	if_.rip = (uintptr_t) ts->entry;
+	if_.R.rdi = (uint64_t) ts->arg;
+	/* 호출 직후처럼 반환 주소 자리를 비워 둔다. */
+	if_.rsp = ((uintptr_t) ts->stack & ~0xf) - sizeof (void *);
+	free (ts);
+
+	/* 시작하기 전에 그룹 종료가 시작되었을 수 있다. */
+	process_check_exit ();
+
+	thread_acct_mode (true);
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
+/* 빈 스택 슬롯을 하나 잡아 스택 페이지를 매핑하고 스택 꼭대기를
+ * 반환한다. 슬롯 번호는 *SLOTP에 저장한다. 실패하면 NULL. */
+static void *
+alloc_thread_stack (int *slotp) {
+	struct process *proc = thread_current ()->proc;
+	enum intr_level old_level;
+	int slot;
+	int i;
+
+	old_level = intr_disable ();
+	for (slot = 0; slot < PROCESS_STACK_SLOTS; slot++)
+		if ((proc->stack_slots & (1ULL << slot)) == 0)
+			break;
+	if (slot < PROCESS_STACK_SLOTS)
+		proc->stack_slots |= 1ULL << slot;
+	intr_set_level (old_level);
+	if (slot == PROCESS_STACK_SLOTS)
+		return NULL;
+
+	for (i = 1; i <= THREAD_STACK_PAGES; i++) {
+		uint8_t *upage = THREAD_STACK_TOP (slot) - i * PGSIZE;
+#ifdef VM
+		if (!vm_alloc_page (VM_ANON | VM_MARKER_0, upage, true)
+				|| !vm_claim_page (upage))
+			break;
+#else
+		void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+		if (kpage == NULL)
+			break;
+		if (!pml4_set_page (proc->pml4, upage, kpage, true)) {
+			palloc_free_page (kpage);
+			break;
+		}
+#endif
+	}
+	if (i <= THREAD_STACK_PAGES) {
+		free_thread_stack (slot);
+		return NULL;
+	}
+	*slotp = slot;
+	return THREAD_STACK_TOP (slot);
+}
+
+/* 스택 슬롯 SLOT의 페이지를 해제하고 슬롯을 비운다. */
+static void
+free_thread_stack (int slot) {
+	struct process *proc = thread_current ()->proc;
+	enum intr_level old_level;
+	int i;
+
+	for (i = 1; i <= THREAD_STACK_PAGES; i++) {
+		uint8_t *upage = THREAD_STACK_TOP (slot) - i * PGSIZE;
+#ifdef VM
+		struct page *page = spt_find_page (&proc->spt, upage);
+		if (page != NULL)
+			spt_remove_page (&proc->spt, page);
+#else
+		void *kpage = pml4_get_page (proc->pml4, upage);
+		if (kpage != NULL) {
+			pml4_clear_page (proc->pml4, upage);
+			palloc_free_page (kpage);
+		}
+#endif
+	}
+
+	old_level = intr_disable ();
+	proc->stack_slots &= ~(1ULL << slot);
+	intr_set_level (old_level);
 }
 
 /* 현재 프로세스의 자원을 해제(free) 한다. */
 static void
 process_cleanup (void) {
 	struct thread *curr = thread_current ();
-	if (curr->running_file != NULL) {
-		file_close(curr->running_file);
-		curr->running_file = NULL;
+	struct process *proc = curr->proc;
+	if (proc->running_file != NULL) {
+		file_close(proc->running_file);
+		proc->running_file = NULL;
 	}
 
 #ifdef VM
-	supplemental_page_table_kill (&curr->spt);
+	supplemental_page_table_kill (&proc->spt);
 #endif
 
 	uint64_t *pml4;
@@ -394,7 +746,7 @@ process_cleanup (void) {
 		 * 프로세스의 페이지 디렉터리를 파괴하기 전에 기본 
 		 * 그렇지 않으면 현재 활성화된 페이지 디렉터리가 이미 파괴된 것이 될 수 있다.
 		 * 그렇게 하지 않으면 이미 해제되고(clear) 페이지 디렉터리가 활성화된 상태가 되어버린다. */
-		curr->pml4 = NULL;
+		curr->pml4 = proc->pml4 = NULL;
 		pml4_activate (NULL);
 		pml4_destroy (pml4);
 	}
@@ -484,9 +836,11 @@ load (const char *file_name, struct intr_frame *if_) {
 	int i;
 
 	/* 페이지 디렉터리를 할당하고 활성화한다. */
-	t->pml4 = pml4_create ();
+	t->pml4 = t->proc->pml4 = pml4_create ();
 	if (t->pml4 == NULL)
 		goto done;
+	t->proc->stack_slots = 0;
+	t->stack_slot = -1;
 	process_activate (thread_current ());
 
 
@@ -570,7 +924,7 @@ load (const char *file_name, struct intr_frame *if_) {
 	if_->rip = ehdr.e_entry;
 	
 	success = true;
-	t->running_file = file;
+	t->proc->running_file = file;
 	return success;
 done:
 	/* We arrive here whether the load is successful or not. */
@@ -660,6 +1014,24 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+		/* -lp 옵션이 켜져 있으면, 파일 내용 없이 0으로만 채워지는(익명)
+		 * 정렬된 2 MB 구간을 큰 페이지 하나로 매핑합니다.
+		 * 큰 페이지를 얻지 못하면 아래의 4 kB 경로로 진행합니다. */
+		if (user_large_pages && writable && read_bytes == 0
+				&& zero_bytes >= LPGSIZE && ((uint64_t) upage & LPGMASK) == 0) {
+			uint8_t *kpage = palloc_get_large (PAL_USER | PAL_ZERO);
+			if (kpage != NULL) {
+				if (pml4_set_large_page (thread_current ()->pml4, upage, kpage,
+							true)) {
+					zero_bytes -= LPGSIZE;
+					upage += LPGSIZE;
+					continue;
+				}
+				/* 이미 페이지 테이블이 있는 구간이면 4 kB로 매핑합니다. */
+				palloc_free_multiple (kpage, LPGSIZE / PGSIZE);
+			}
+		}
+
 		/* Get a page of memory. */
 		uint8_t *kpage = palloc_get_page (PAL_USER);
 		if (kpage == NULL)
@@ -1,6 +1,8 @@
 #include "userprog/syscall.h"
+#include <limits.h>
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <rusage.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
@@ -12,6 +14,8 @@
 #include "filesys/file.h"
 #include "threads/palloc.h"
 #include "userprog/process.h"
+#include "userprog/futex.h"
+#include "devices/input.h"
 
 
 void syscall_entry (void);
@@ -45,6 +49,12 @@ int sys_write (int fd, const void *buffer, unsigned size);
 void sys_seek (int fd, unsigned position);
 unsigned sys_tell (int fd);
 void sys_close (int fd);
+int sys_getrusage (struct rusage *usage);
+bool sys_sched_setdeadline (int64_t runtime, int64_t period, int64_t deadline);
+int sys_futex_wait (int *uaddr, int val);
+int sys_futex_wake (int *uaddr, int cnt);
+tid_t sys_thread_create (void *entry, void *arg, void *stack);
+void sys_thread_exit (int *clear);
 ///////////// - System Call - /////////////////
 
 
@@ -63,7 +73,8 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-    lock_init(&file_lock);
+    lock_init_adaptive(&file_lock, "file_lock");
+    futex_init();
 }
 
 /* The main system call interface */
@@ -71,6 +82,7 @@ syscall_init (void) {
 void
 syscall_handler (struct intr_frame *f UNUSED) {
     // TODO: Your implementation goes here.
+    thread_acct_mode (false);
     switch (f->R.rax) {
         case 0:  // SYS_HALT
             sys_halt();
@@ -136,10 +148,30 @@ syscall_handler (struct intr_frame *f UNUSED) {
             break;
         case 24: // SYS_UMOUNT
             break;
+        case 25: // SYS_GETRUSAGE
+            f->R.rax = sys_getrusage((struct rusage *) f->R.rdi);
+            break;
+        case 26: // SYS_SCHED_SETDEADLINE
+            f->R.rax = sys_sched_setdeadline(f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+        case 27: // SYS_FUTEX_WAIT
+            f->R.rax = sys_futex_wait((int *) f->R.rdi, f->R.rsi);
+            break;
+        case 28: // SYS_FUTEX_WAKE
+            f->R.rax = sys_futex_wake((int *) f->R.rdi, f->R.rsi);
+            break;
+        case 29: // SYS_THREAD_CREATE
+            f->R.rax = sys_thread_create((void *) f->R.rdi, (void *) f->R.rsi, (void *) f->R.rdx);
+            break;
+        case 30: // SYS_THREAD_EXIT
+            sys_thread_exit((int *) f->R.rdi);
+            break;
         default:
             // Unknown system call
             break;
     }
+    process_check_exit();
+    thread_acct_mode (true);
 }
 
 bool check_pml4_addr(char *file){
@@ -162,9 +194,25 @@ void sys_exit (int status){
 
     struct list_elem *e;
 	struct thread *cur = thread_current ();
-    for (e = list_begin(&cur->parent->child); e != list_end(&cur->parent->child); e = list_next(e)) {
+    struct thread *parent = cur->parent;
+    tid_t pid = cur->tid;
+
+    /* 프로세스의 모든 쓰레드를 끝낸 뒤 상태를 알린다. 다른 쓰레드가
+       먼저 exit()했다면 그 쓰레드가 알리므로 조용히 빠진다. */
+    if(cur->proc != NULL){
+        if(!process_begin_exit()){
+            thread_exit();
+        }
+        parent = cur->proc->parent;
+        pid = cur->proc->pid;
+    }
+    /* 부모를 깨워도 종료 메시지를 찍을 때까지는 양보를 미룬다. 그래야
+       부모의 출력이 종료 메시지보다 앞서지 않는다. sleep할 수 있는
+       process_exit()에 들어가기 전에 다시 허용한다. */
+    thread_preempt_disable();
+    for (e = list_begin(&parent->child); e != list_end(&parent->child); e = list_next(e)) {
         struct child_status *cs = list_entry(e, struct child_status, elem);
-		if (cur->tid == cs->tid){
+		if (pid == cs->tid){
             cs->exit_status = status;
             cs->has_exited = true;
             sema_up(&cs->wait_sema);
@@ -173,6 +221,7 @@ void sys_exit (int status){
 	}
 
 	printf("%s: exit(%d)\n",cur->name ,status);
+    thread_preempt_enable();
 	thread_exit ();
 }
 // SYS_FORK
@@ -184,6 +233,10 @@ int sys_exec (const char *cmd_line)	{
     if(!check_pml4_addr(cmd_line)){
         sys_exit(-1);
     }
+    /* 다른 쓰레드가 쓰고 있는 주소 공간은 바꿀 수 없다. */
+    if(process_is_shared()){
+        return -1;
+    }
     char *copy_cmd_line = palloc_get_page(PAL_ZERO);
     if(copy_cmd_line == NULL){
         sys_exit(-1);
@@ -233,7 +286,7 @@ int sys_open(const char *file) {
     bool check = true;
 	struct thread *cur = thread_current();
 	for (fd = 2; fd < 64; fd++) {
-		if (cur->fdt[fd] == NULL) {
+		if (cur->proc->fdt[fd] == NULL) {
             check = false;
 			break;
 		}
@@ -247,7 +300,7 @@ int sys_open(const char *file) {
       file_deny_write(f);
     lock_release(&file_lock);
 	if (f == NULL) return -1;
-	cur->fdt[fd] = f;
+	cur->proc->fdt[fd] = f;
 	return fd;
 }
 
@@ -259,11 +312,11 @@ int sys_filesize (int fd){
     if(fd<2 || fd>64){
         sys_exit(-1);
     }
-    if (cur->fdt[fd] == NULL){
+    if (cur->proc->fdt[fd] == NULL){
         return 0;
     }
     lock_acquire(&file_lock);
-    int res = file_length(cur->fdt[fd]);
+    int res = file_length(cur->proc->fdt[fd]);
     lock_release(&file_lock);
     return res;
 	
@@ -273,15 +326,25 @@ int sys_read (int fd, void *buffer, unsigned size){
     struct thread *cur = thread_current();
     // 표준 입력(Standard Input) //
     if(fd == 0){
-        for(int i=0; i<size; i++){
+        unsigned i;
+        /* 키를 기다리는 동안 그룹 종료가 시작되면 읽은 데까지만 반환한다. */
+        for(i=0; i<size; i++){
+            enum intr_level old_level = intr_disable();
+            while(input_empty() && !cur->proc->exiting)
+                input_wait(process_sleep);
+            if(input_empty()){
+                intr_set_level(old_level);
+                break;
+            }
             ((char*)buffer)[i] = input_getc();
+            intr_set_level(old_level);
         }
-        return size;
+        return i;
     }
     if(fd<2 || fd>64){
         sys_exit(-1);
     }
-    struct  file *f = cur->fdt[fd];
+    struct  file *f = cur->proc->fdt[fd];
     if(!check_pml4_addr(buffer)){
         sys_exit(-1);
     }
@@ -311,7 +374,7 @@ int sys_write (int fd, const void *buffer, unsigned size){
     }
    
     lock_acquire(&file_lock);
-    int res = file_write(thread_current()->fdt[fd],buffer,size);
+    int res = file_write(thread_current()->proc->fdt[fd],buffer,size);
     lock_release(&file_lock);
     if(res<0){
         return -1;
@@ -324,7 +387,7 @@ void sys_seek (int fd, unsigned position){
         sys_exit(-1);
     }
     struct thread *cur = thread_current();
-    struct file *f = cur->fdt[fd];
+    struct file *f = cur->proc->fdt[fd];
     
     if (f == NULL){
         return 0;
@@ -339,7 +402,7 @@ unsigned sys_tell (int fd){
         sys_exit(-1);
     }
     struct thread *cur = thread_current();
-    struct file *f = cur->fdt[fd];
+    struct file *f = cur->proc->fdt[fd];
 
     if (f == NULL){
         return 0;
@@ -356,14 +419,78 @@ void sys_close(int fd) {
     }
     struct thread *cur = thread_current();
 
-    if(cur->fdt[fd] == NULL){
+    if(cur->proc->fdt[fd] == NULL){
         sys_exit(-1);
     }
-    struct file *f = cur->fdt[fd];
-    cur->fdt[fd] = NULL;
+    struct file *f = cur->proc->fdt[fd];
+    cur->proc->fdt[fd] = NULL;
 
     file_allow_write(f);
     lock_acquire(&file_lock);
     file_close(f);
     lock_release(&file_lock);
 }
+
+// SYS_GETRUSAGE
+int sys_getrusage (struct rusage *usage){
+    if(!check_pml4_addr((char *) usage) || !check_pml4_addr((char *) (usage + 1) - 1)){
+        sys_exit(-1);
+    }
+    thread_get_rusage(usage);
+    return 0;
+}
+
+// SYS_SCHED_SETDEADLINE
+bool sys_sched_setdeadline (int64_t runtime, int64_t period, int64_t deadline){
+    return thread_set_deadline(runtime, period, deadline);
+}
+
+/* futex 주소가 정렬된 유효한 유저 주소인지 확인한다. */
+static bool check_futex_addr(int *uaddr){
+    return ((uintptr_t) uaddr & (sizeof *uaddr - 1)) == 0
+        && check_pml4_addr((char *) uaddr);
+}
+
+// SYS_FUTEX_WAIT
+int sys_futex_wait (int *uaddr, int val){
+    if(!check_futex_addr(uaddr)){
+        sys_exit(-1);
+    }
+    return futex_wait(uaddr, val) ? 0 : -1;
+}
+
+// SYS_FUTEX_WAKE
+int sys_futex_wake (int *uaddr, int cnt){
+    if(!check_futex_addr(uaddr)){
+        sys_exit(-1);
+    }
+    return futex_wake(uaddr, cnt);
+}
+
+// SYS_THREAD_CREATE
+tid_t sys_thread_create (void *entry, void *arg, void *stack){
+    /* STACK이 NULL이면 커널이 스택을 할당하므로 검사하지 않는다. */
+    if(entry == NULL || !is_user_vaddr(entry)
+            || (stack != NULL && !is_user_vaddr((char *) stack - 1))){
+        return TID_ERROR;
+    }
+    return process_create_thread(entry, arg, stack);
+}
+
+// SYS_THREAD_EXIT
+void sys_thread_exit (int *clear){
+    /* join하는 쓰레드가 기다리는 futex를 0으로 만들고 깨운다. */
+    if(clear != NULL && check_futex_addr(clear)){
+        *clear = 0;
+        futex_wake(clear, INT_MAX);
+    }
+    /* 마지막 쓰레드라면 프로세스가 끝나는 것이므로 exit(0)과 같다.
+       확인부터 process_exit()의 카운트 감소까지 인터럽트를 꺼서
+       두 쓰레드가 동시에 서로를 마지막이 아니라고 보는 일을 막는다. */
+    intr_disable();
+    if(!process_is_shared()){
+        intr_enable();
+        sys_exit(0);
+    }
+    thread_exit();
+}